@@ -0,0 +1,85 @@
+
+#include "data_aggregator.h"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <limits>
+#include <spdlog/spdlog.h>
+
+namespace fs = boost::filesystem;
+
+//--------------------------------------------------------------------------------------------------
+
+std::string MinuteSummary::format() const
+{
+    return fmt::format("summary {} count={} min={} max={} mean={:.3f} histogram={}\n", minute, count, min, max, mean,
+                       fmt::join(histogram, ","));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+DataAggregator::DataAggregator(short min_value, short max_value) : m_min_value(min_value), m_max_value(max_value)
+{
+    assert(min_value <= max_value);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+boost::optional<MinuteSummary> DataAggregator::aggregate(const fs::path &path) const
+{
+    std::ifstream file;
+    file.open(path.c_str());
+
+    if (!file.is_open())
+    {
+        spdlog::error("Failed to open file for aggregation: {}", path.string());
+        return {};
+    }
+
+    MinuteSummary summary{};
+    summary.minute = std::strtoll(path.stem().c_str(), nullptr, 10);
+    summary.min    = std::numeric_limits<short>::max();
+    summary.max    = std::numeric_limits<short>::min();
+
+    int64_t sum = 0;
+    short   value;
+    int64_t timestamp;
+
+    // each record is a line of "<value> <timestamp>", all statistics are gathered in a single pass
+    while (file >> value >> timestamp)
+    {
+        summary.count++;
+        summary.min = std::min(summary.min, value);
+        summary.max = std::max(summary.max, value);
+        summary.histogram[bucketOf(value)]++;
+        sum += value;
+    }
+
+    // stopping before the end means malformed record, partial summary would let the rest of the data get lost
+    if (!file.eof())
+    {
+        spdlog::error("Malformed record after {} records in file: {}", summary.count, path.string());
+        return {};
+    }
+
+    if (summary.count == 0)
+    {
+        summary.min = summary.max = 0;
+    }
+    else
+    {
+        summary.mean = static_cast<double>(sum) / static_cast<double>(summary.count);
+    }
+
+    return summary;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t DataAggregator::bucketOf(short value) const
+{
+    const auto clamped = std::min(std::max(value, m_min_value), m_max_value);
+    const auto range   = static_cast<std::size_t>(m_max_value - m_min_value) + 1;
+
+    return static_cast<std::size_t>(clamped - m_min_value) * MinuteSummary::histogram_buckets / range;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <boost/filesystem/path.hpp>
+#include <boost/optional/optional.hpp>
+#include <cstdint>
+#include <string>
+
+//--------------------------------------------------------------------------------------------------
+
+enum class AggregationMode
+{
+    raw,           // only raw data files are distributed
+    summary,       // only per minute summaries are distributed, raw data is dropped
+    summary_first  // summaries are distributed first, raw data files follow afterwards
+};
+
+//--------------------------------------------------------------------------------------------------
+
+struct MinuteSummary
+{
+    static constexpr std::size_t histogram_buckets = 10;
+
+    int64_t                                 minute;
+    uint64_t                                count;
+    short                                   min;
+    short                                   max;
+    double                                  mean;
+    std::array<uint64_t, histogram_buckets> histogram;
+
+    std::string format() const;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+class DataAggregator
+{
+public:
+    DataAggregator(short min_value, short max_value);
+
+    boost::optional<MinuteSummary> aggregate(const boost::filesystem::path &path) const;
+
+private:
+    std::size_t bucketOf(short value) const;
+
+    const short m_min_value;
+    const short m_max_value;
+};
@@ -1,6 +1,8 @@
 
 #include "data_distributor.h"
+#include "data_values.h"
 #include "file_extensions.h"
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <boost/filesystem.hpp>
 #include <chrono>
@@ -11,17 +13,57 @@ namespace fs = boost::filesystem;
 
 //--------------------------------------------------------------------------------------------------
 
-DataDistributor::DataDistributor(boost::asio::io_service &io_context, const fs::path &output_dir,
-                                 const std::string &address, uint16_t port, std::chrono::seconds distribution_period)
+DataDistributor::DataDistributor(boost::asio::io_service &io_context, const fs::path &output_dir, OutputLayout layout,
+                                 const std::string &address, uint16_t port, uint64_t upload_rate, uint64_t upload_burst,
+                                 std::chrono::seconds distribution_period,
+                                 std::chrono::milliseconds tail_period, AggregationMode aggregation_mode,
+                                 uint64_t trace_sampling, std::chrono::seconds trace_report_period,
+                                 TraceRecorder *trace_recorder, const TraceReplay *trace_replay)
     : m_io_context(io_context),
       m_output_dir(output_dir),
+      m_layout(layout),
       m_distribution_period(distribution_period),
+      m_tail_period(tail_period),
+      m_aggregation_mode(aggregation_mode),
+      m_trace_report_period(trace_report_period),
+      m_backlog_reserve(upload_burst / 2),
+      m_trace_recorder(trace_recorder),
+      m_trace_replay(trace_replay),
+      m_replay_events(trace_replay ? trace_replay->getEvents(TraceEventType::distribution)
+                                   : std::vector<TraceEvent>()),
+      m_replay_index(1),  // first recorded distribution is the initial one below
       m_timer(io_context),
+      m_tail_timer(io_context),
+      m_report_timer(io_context),
+      m_deferred_timer(io_context),
       m_distribution_count(),
-      m_transmitter(io_context, address, port)
+      m_transmitter(io_context, address, port, upload_rate, upload_burst),
+      m_aggregator(data_values::min_generated_value, data_values::max_generated_value),
+      m_tracer(trace_sampling),
+      m_tail_offsets(),
+      m_summarized_files(),
+      m_deferred_fresh_files(),
+      m_deferred_backlog_files()
 {
     // force early initial distribution
     handlePeriodicUpdate();
+
+    // live streaming of files which are still being written is optional and only makes sense for raw data
+    if (m_tail_period.count() > 0 && m_aggregation_mode != AggregationMode::raw)
+    {
+        spdlog::warn("Live streaming is supported only for raw data distribution, it will be disabled");
+    }
+    else if (m_tail_period.count() > 0)
+    {
+        m_tail_timer.expires_from_now(m_tail_period);
+        m_tail_timer.async_wait(std::bind(&DataDistributor::handleTailUpdate, this));
+    }
+
+    if (m_tracer.isEnabled() && m_trace_report_period.count() > 0)
+    {
+        m_report_timer.expires_from_now(m_trace_report_period);
+        m_report_timer.async_wait(std::bind(&DataDistributor::handleReportUpdate, this));
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -33,13 +75,25 @@ uint64_t DataDistributor::getDistributionCount() const
 
 //--------------------------------------------------------------------------------------------------
 
+void DataDistributor::reportLatencies() const
+{
+    m_tracer.report();
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void DataDistributor::handlePeriodicUpdate()
 {
     // start new timeout
-    m_timer.expires_from_now(m_distribution_period);
-    m_timer.async_wait(std::bind(&DataDistributor::handlePeriodicUpdate, this));
+    scheduleNextDistribution();
+
+    if (m_trace_recorder)
+    {
+        m_trace_recorder->record(TraceEventType::distribution);
+    }
 
-    const auto &distribution_files = collectDistributionFiles();
+    const auto &directories        = output_layout::collectDirectories(m_output_dir, m_layout);
+    const auto &distribution_files = collectDistributionFiles(directories);
 
     if (!distributeFiles(distribution_files))
     {
@@ -49,67 +103,217 @@ void DataDistributor::handlePeriodicUpdate()
     {
         m_distribution_count += distribution_files.size() != 0 ? 1UL : 0UL;
     }
+
+    if (m_layout == OutputLayout::partitioned)
+    {
+        removeDrainedPartitions(directories);
+    }
 }
 
 //--------------------------------------------------------------------------------------------------
 
-std::vector<fs::path> DataDistributor::collectDistributionFiles() const
+void DataDistributor::scheduleNextDistribution()
+{
+    if (m_replay_index < m_replay_events.size())
+    {
+        m_timer.expires_at(m_trace_replay->getScheduledTime(m_replay_events[m_replay_index++]));
+    }
+    else
+    {
+        // regular distribution continues once all recorded cycles were replayed
+        m_timer.expires_from_now(m_distribution_period);
+    }
+
+    m_timer.async_wait(std::bind(&DataDistributor::handlePeriodicUpdate, this));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::vector<fs::path> DataDistributor::collectDistributionFiles(const std::vector<fs::path> &directories) const
 {
     using dir_it = fs::directory_iterator;
 
     std::vector<fs::path> distribution_files;
 
-    for (auto it = dir_it(m_output_dir); it != dir_it(); it++)
+    for (const auto &dir : directories)
     {
-        auto file_name = it->path().filename();
-
-        if (fs::is_regular_file(*it))
+        for (auto it = dir_it(dir); it != dir_it(); it++)
         {
-            // skip lock files and any other unrelated file
-            if (file_name.extension() == file_extensions::data &&
-                file_name.extension().extension() != file_extensions::lock)
+            auto file_name = it->path().filename();
+
+            if (fs::is_regular_file(*it))
             {
-                auto lock_file_path = it->path();
-                lock_file_path.concat(file_extensions::lock);
-                // skip if lock file for this data file exists
-                if (!fs::exists(lock_file_path))
+                // skip lock files and any other unrelated file
+                if (file_name.extension() == file_extensions::data &&
+                    file_name.extension().extension() != file_extensions::lock)
                 {
-                    distribution_files.push_back(it->path());
-                }
-                else
-                {
-                    spdlog::debug("Skipping distribution of {} because it's locked", it->path().string());
+                    auto lock_file_path = it->path();
+                    lock_file_path.concat(file_extensions::lock);
+                    // skip if lock file for this data file exists
+                    if (!fs::exists(lock_file_path))
+                    {
+                        distribution_files.push_back(it->path());
+                    }
+                    else
+                    {
+                        spdlog::debug("Skipping distribution of {} because it's locked", it->path().string());
+                    }
                 }
             }
+            else if (m_layout == OutputLayout::flat || !fs::is_directory(*it))
+            {
+                spdlog::warn("Output directory contains non regular file: {}", file_name.string());
+            }
         }
-        else
+    }
+
+    return distribution_files;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool DataDistributor::distributeFiles(const std::vector<fs::path> &collected_files)
+{
+    std::vector<fs::path> files(collected_files);
+    bool                  summarized_all = true;
+
+    if (m_aggregation_mode != AggregationMode::raw)
+    {
+        // raw data must not get ahead of summaries, so it waits until they are delivered
+        if (!distributeSummaries(files))
+        {
+            return false;
+        }
+
+        // malformed files were moved aside and are not distributed at all
+        summarized_all = files.size() == collected_files.size();
+
+        if (m_aggregation_mode == AggregationMode::summary)
         {
-            spdlog::warn("Output directory contains non regular file: {}", file_name.string());
+            for (const auto &path : files)
+            {
+                // files which summaries failed to be delivered previously are kept for the next distribution
+                if (m_summarized_files.erase(path) != 0)
+                {
+                    removeDistributedFile(path);
+                }
+            }
+
+            return summarized_all;
         }
     }
 
-    return distribution_files;
+    std::vector<fs::path> fresh_files;
+    std::vector<fs::path> backlog_files;
+    splitByPriority(files, fresh_files, backlog_files);
+
+    // files which were deferred previously and are collected again are taken over by this distribution,
+    // other deferred files are kept, e.g. when just a single file is distributed after its tail was streamed
+    const auto is_collected = [&files](const fs::path &path) {
+        return std::find(files.begin(), files.end(), path) != files.end();
+    };
+    m_deferred_fresh_files.erase(
+        std::remove_if(m_deferred_fresh_files.begin(), m_deferred_fresh_files.end(), is_collected),
+        m_deferred_fresh_files.end());
+    m_deferred_backlog_files.erase(
+        std::remove_if(m_deferred_backlog_files.begin(), m_deferred_backlog_files.end(), is_collected),
+        m_deferred_backlog_files.end());
+
+    const bool distributed_all = distributeDeferrableFiles(fresh_files, backlog_files);
+
+    if (!m_deferred_backlog_files.empty())
+    {
+        spdlog::info("Deferring distribution of {} backlog files due to upload rate limit",
+                     m_deferred_backlog_files.size());
+    }
+
+    scheduleDeferredDistribution();
+
+    return distributed_all && summarized_all;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-bool DataDistributor::distributeFiles(const std::vector<fs::path> &files)
+bool DataDistributor::distributeDeferrableFiles(const std::vector<fs::path> &fresh_files,
+                                                const std::vector<fs::path> &backlog_files)
 {
-    bool distributed_all = true;
+    // fresh data goes as soon as the rate limiter allows, files which already wait for it go first
+    std::vector<fs::path> files(m_deferred_fresh_files);
+    files.insert(files.end(), fresh_files.begin(), fresh_files.end());
+    m_deferred_fresh_files.clear();
+
+    const bool distributed_fresh = distributeRawFiles(files, 0, m_deferred_fresh_files);
+
+    // backlog waits while fresh data does, otherwise smaller backlog files would take tokens it needs
+    if (!m_deferred_fresh_files.empty())
+    {
+        m_deferred_backlog_files.insert(m_deferred_backlog_files.end(), backlog_files.begin(), backlog_files.end());
+        std::sort(m_deferred_backlog_files.begin(), m_deferred_backlog_files.end());
+
+        return distributed_fresh;
+    }
+
+    // backlog must leave a reserve for fresh data
+    files.assign(backlog_files.begin(), backlog_files.end());
+    files.insert(files.end(), m_deferred_backlog_files.begin(), m_deferred_backlog_files.end());
+    std::sort(files.begin(), files.end());
+    m_deferred_backlog_files.clear();
+
+    const bool distributed_backlog = distributeRawFiles(files, m_backlog_reserve, m_deferred_backlog_files);
+
+    return distributed_fresh && distributed_backlog;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataDistributor::splitByPriority(const std::vector<fs::path> &files, std::vector<fs::path> &fresh_files,
+                                      std::vector<fs::path> &backlog_files) const
+{
+    const auto last_distribution = std::chrono::system_clock::now() - m_distribution_period;
+    const auto last_distribution_minutes =
+        std::chrono::duration_cast<std::chrono::minutes>(last_distribution.time_since_epoch()).count();
 
     for (const auto &path : files)
     {
+        // files which became ready since previous distribution are fresh, raw data following summaries is never
+        const auto file_minutes = std::strtoll(path.stem().c_str(), nullptr, 10);
+        const bool was_deferred = std::find(m_deferred_fresh_files.begin(), m_deferred_fresh_files.end(), path) !=
+                                  m_deferred_fresh_files.end();
+        const bool is_fresh = m_aggregation_mode != AggregationMode::summary_first &&
+                              (file_minutes >= last_distribution_minutes - 1 || was_deferred);
+
+        (is_fresh ? fresh_files : backlog_files).push_back(path);
+    }
+
+    // oldest data is sent first within each lane
+    std::sort(fresh_files.begin(), fresh_files.end());
+    std::sort(backlog_files.begin(), backlog_files.end());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool DataDistributor::distributeRawFiles(const std::vector<fs::path> &files, uint64_t reserved_bytes,
+                                         std::vector<fs::path> &deferred_files)
+{
+    bool distributed_all = true;
+
+    for (auto it = files.begin(); it != files.end(); it++)
+    {
+        const auto &path = *it;
+
+        // waiting for the rate limiter here would block tail streaming and the next distribution
+        const auto delay = m_transmitter.getTransmitDelay(getRemainingSize(path), reserved_bytes);
+
+        if (delay > TokenBucket::clock::duration::zero())
+        {
+            deferred_files.insert(deferred_files.end(), it, files.end());
+            break;
+        }
+
         if (distributeFile(path))
         {
-            // remove distributed files from filesystem
-            if (fs::remove(path))
-            {
-                spdlog::info("Successfully removed file: {}", path.string());
-            }
-            else
-            {
-                spdlog::warn("Failed to remove file: {}", path.string());
-            }
+            m_summarized_files.erase(path);
+            removeDistributedFile(path);
         }
         else
         {
@@ -122,6 +326,67 @@ bool DataDistributor::distributeFiles(const std::vector<fs::path> &files)
 
 //--------------------------------------------------------------------------------------------------
 
+std::uintmax_t DataDistributor::getRemainingSize(const fs::path &path) const
+{
+    boost::system::error_code error_code;
+    const auto                file_size = fs::file_size(path, error_code);
+
+    if (error_code.failed())
+    {
+        return 0;
+    }
+
+    // part of the file which was already streamed while it was being written is not sent again
+    const auto tail_it        = m_tail_offsets.find(path);
+    const auto streamed_bytes = tail_it != m_tail_offsets.end() ? tail_it->second : 0UL;
+
+    return file_size > streamed_bytes ? file_size - streamed_bytes : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataDistributor::scheduleDeferredDistribution()
+{
+    // fresh files are retried first, backlog only once they are all sent and with the reserve left for fresh data
+    const bool is_fresh = !m_deferred_fresh_files.empty();
+    const auto &files   = is_fresh ? m_deferred_fresh_files : m_deferred_backlog_files;
+
+    if (files.empty())
+    {
+        m_deferred_timer.cancel();
+        return;
+    }
+
+    const auto reserved_bytes = is_fresh ? 0 : m_backlog_reserve;
+    const auto delay          = m_transmitter.getTransmitDelay(getRemainingSize(files.front()), reserved_bytes);
+
+    spdlog::debug("Deferring distribution of {} {} files by {}ms due to upload rate limit", files.size(),
+                  is_fresh ? "fresh" : "backlog", std::chrono::duration_cast<std::chrono::milliseconds>(delay).count());
+
+    m_deferred_timer.expires_from_now(delay);
+    m_deferred_timer.async_wait(std::bind(&DataDistributor::handleDeferredDistribution, this, std::placeholders::_1));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataDistributor::handleDeferredDistribution(const boost::system::error_code &error_code)
+{
+    // rescheduled by a distribution which took over the deferred files
+    if (error_code == boost::asio::error::operation_aborted)
+    {
+        return;
+    }
+
+    if (!distributeDeferrableFiles({}, {}))
+    {
+        spdlog::warn("Failed to distribute all deferred files, will retry on next distribution");
+    }
+
+    scheduleDeferredDistribution();
+}
+
+//--------------------------------------------------------------------------------------------------
+
 bool DataDistributor::distributeFile(const fs::path &path)
 {
     bool succeed = false;
@@ -131,13 +396,23 @@ bool DataDistributor::distributeFile(const fs::path &path)
 
     if (file.is_open())
     {
+        // skip part of the file which was already streamed while it was being written
+        const auto tail_it        = m_tail_offsets.find(path);
+        const auto streamed_bytes = tail_it != m_tail_offsets.end() ? tail_it->second : 0UL;
+        file.seekg(static_cast<std::streamoff>(streamed_bytes));
+
         // @note this is not efficient but rather simple solution for small files
         const std::string file_content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 
-        if (m_transmitter.transmit(file_content))
+        if ((streamed_bytes != 0 && file_content.empty()) || transmitRecords(file_content))
         {
             spdlog::info("Distributed file {} to server", path.string());
             succeed = true;
+
+            if (tail_it != m_tail_offsets.end())
+            {
+                m_tail_offsets.erase(tail_it);
+            }
         }
         else
         {
@@ -152,3 +427,235 @@ bool DataDistributor::distributeFile(const fs::path &path)
     file.close();
     return succeed;
 }
+
+//--------------------------------------------------------------------------------------------------
+
+bool DataDistributor::distributeSummaries(std::vector<fs::path> &files)
+{
+    std::string           payload;
+    std::vector<fs::path> summarized_files;
+    std::vector<fs::path> malformed_files;
+
+    // summaries of all files are batched into a single request
+    for (const auto &path : files)
+    {
+        if (m_summarized_files.count(path) == 0)
+        {
+            const auto &summary = m_aggregator.aggregate(path);
+            if (summary)
+            {
+                payload += summary->format();
+                summarized_files.push_back(path);
+            }
+            else
+            {
+                malformed_files.push_back(path);
+            }
+        }
+    }
+
+    // parsing would fail the same way on every distribution, so such files are moved out of the way
+    for (const auto &path : malformed_files)
+    {
+        quarantineFile(path);
+        files.erase(std::find(files.begin(), files.end(), path));
+    }
+
+    if (summarized_files.empty())
+    {
+        return true;
+    }
+
+    if (!m_transmitter.transmit(payload))
+    {
+        spdlog::warn("Failed to distribute summaries of {} files", summarized_files.size());
+        return false;
+    }
+
+    spdlog::info("Distributed summaries of {} files to server", summarized_files.size());
+    m_summarized_files.insert(summarized_files.begin(), summarized_files.end());
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataDistributor::removeDistributedFile(const fs::path &path) const
+{
+    // remove distributed files from filesystem
+    if (fs::remove(path))
+    {
+        spdlog::info("Successfully removed file: {}", path.string());
+    }
+    else
+    {
+        spdlog::warn("Failed to remove file: {}", path.string());
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataDistributor::quarantineFile(const fs::path &path) const
+{
+    // moved to output directory itself so that its partition can be drained, extension keeps it from distribution
+    const auto quarantine_path = m_output_dir / (path.filename().string() + file_extensions::malformed);
+
+    boost::system::error_code error_code;
+    fs::rename(path, quarantine_path, error_code);
+
+    if (error_code.failed())
+    {
+        spdlog::error("Failed to move malformed file {} aside, message: {}", path.string(), error_code.message());
+    }
+    else
+    {
+        spdlog::warn("Moved malformed file {} aside to {}", path.string(), quarantine_path.string());
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataDistributor::removeDrainedPartitions(const std::vector<fs::path> &directories) const
+{
+    const auto now             = std::chrono::system_clock::now().time_since_epoch();
+    const auto elapsed_minutes = std::chrono::duration_cast<std::chrono::minutes>(now).count();
+
+    // generator may be opening a file in the current partition or still finishing the previous one
+    const auto current_partition  = output_layout::directoryFor(m_output_dir, m_layout, elapsed_minutes);
+    const auto previous_partition = output_layout::directoryFor(m_output_dir, m_layout, elapsed_minutes - 1);
+
+    for (const auto &dir : directories)
+    {
+        if (dir != m_output_dir && dir != current_partition && dir != previous_partition)
+        {
+            output_layout::removeIfDrained(dir, current_partition.parent_path());
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataDistributor::handleTailUpdate()
+{
+    // start new timeout
+    m_tail_timer.expires_from_now(m_tail_period);
+    m_tail_timer.async_wait(std::bind(&DataDistributor::handleTailUpdate, this));
+
+    for (const auto &path : collectTailFiles())
+    {
+        auto lock_file_path = path;
+        lock_file_path.concat(file_extensions::lock);
+
+        if (!fs::exists(path))
+        {
+            // nothing written yet or file was already distributed by periodic update
+            m_tail_offsets.erase(path);
+        }
+        else if (fs::exists(lock_file_path))
+        {
+            if (!streamFileTail(path))
+            {
+                spdlog::warn("Failed to stream tail of file {}, will retry on next update", path.string());
+            }
+        }
+        else if (m_tail_offsets.count(path) != 0)
+        {
+            // file was closed meanwhile, send the rest of it right away instead of waiting for distribution
+            distributeFiles({path});
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::vector<fs::path> DataDistributor::collectTailFiles() const
+{
+    std::vector<fs::path> tail_files;
+
+    for (const auto &entry : m_tail_offsets)
+    {
+        tail_files.push_back(entry.first);
+    }
+
+    // generator writes either to the file of current minute or is still holding the one of previous minute,
+    // so there is no need to scan whole output directory
+    const auto now             = std::chrono::system_clock::now().time_since_epoch();
+    const auto elapsed_minutes = std::chrono::duration_cast<std::chrono::minutes>(now).count();
+
+    for (const auto minutes : {elapsed_minutes - 1, elapsed_minutes})
+    {
+        const auto path = output_layout::directoryFor(m_output_dir, m_layout, minutes) /
+                          (std::to_string(minutes) + file_extensions::data);
+
+        if (m_tail_offsets.count(path) == 0)
+        {
+            tail_files.push_back(path);
+        }
+    }
+
+    return tail_files;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool DataDistributor::streamFileTail(const fs::path &path)
+{
+    std::ifstream file;
+    file.open(path.c_str());
+
+    if (!file.is_open())
+    {
+        spdlog::error("Failed to open file for reading: {}", path.string());
+        return false;
+    }
+
+    auto &streamed_bytes = m_tail_offsets[path];
+    file.seekg(static_cast<std::streamoff>(streamed_bytes));
+
+    std::string tail((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // only complete records are streamed, partially written one will be picked up on next update
+    const auto records_end = tail.rfind('\n');
+    if (records_end == std::string::npos)
+    {
+        return true;
+    }
+
+    tail.resize(records_end + 1);
+
+    if (!transmitRecords(tail))
+    {
+        return false;
+    }
+
+    streamed_bytes += tail.size();
+    spdlog::debug("Streamed {} bytes of file {} to server", tail.size(), path.string());
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool DataDistributor::transmitRecords(const std::string &payload)
+{
+    const auto upload_start = std::chrono::system_clock::now();
+
+    if (!m_transmitter.transmit(payload))
+    {
+        return false;
+    }
+
+    m_tracer.trace(payload, upload_start, std::chrono::system_clock::now());
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataDistributor::handleReportUpdate()
+{
+    // start new timeout
+    m_report_timer.expires_from_now(m_trace_report_period);
+    m_report_timer.async_wait(std::bind(&DataDistributor::handleReportUpdate, this));
+
+    m_tracer.report();
+}
@@ -1,11 +1,17 @@
 #pragma once
 
+#include "data_aggregator.h"
 #include "http_transmitter.h"
+#include "latency_tracer.h"
+#include "output_layout.h"
+#include "trace.h"
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/optional/optional_fwd.hpp>
 #include <chrono>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -23,20 +29,70 @@ class DataDistributor
 {
 public:
     DataDistributor(boost::asio::io_context &io_context, const boost::filesystem::path &output_dir,
-                    const std::string &address, uint16_t port, std::chrono::seconds distribution_period);
+                    OutputLayout layout, const std::string &address, uint16_t port, uint64_t upload_rate,
+                    uint64_t upload_burst, std::chrono::seconds distribution_period, std::chrono::milliseconds tail_period,
+                    AggregationMode aggregation_mode, uint64_t trace_sampling,
+                    std::chrono::seconds trace_report_period, TraceRecorder *trace_recorder,
+                    const TraceReplay *trace_replay);
 
     uint64_t getDistributionCount() const;
+    void     reportLatencies() const;
 
 private:
-    void                                 handlePeriodicUpdate();
-    std::vector<boost::filesystem::path> collectDistributionFiles() const;
-    bool                                 distributeFiles(const std::vector<boost::filesystem::path> &files);
-    bool                                 distributeFile(const boost::filesystem::path &path);
-
-    boost::asio::io_context &     m_io_context;
-    const boost::filesystem::path m_output_dir;
-    const std::chrono::seconds    m_distribution_period;
-    boost::asio::steady_timer     m_timer;
-    uint64_t                      m_distribution_count;
-    HttpTransmitter               m_transmitter;
+    void handlePeriodicUpdate();
+    void scheduleNextDistribution();
+    std::vector<boost::filesystem::path> collectDistributionFiles(
+        const std::vector<boost::filesystem::path> &directories) const;
+    bool distributeFiles(const std::vector<boost::filesystem::path> &collected_files);
+    void splitByPriority(const std::vector<boost::filesystem::path> &files,
+                         std::vector<boost::filesystem::path> &      fresh_files,
+                         std::vector<boost::filesystem::path> &      backlog_files) const;
+    bool distributeDeferrableFiles(const std::vector<boost::filesystem::path> &fresh_files,
+                                   const std::vector<boost::filesystem::path> &backlog_files);
+    bool distributeRawFiles(const std::vector<boost::filesystem::path> &files, uint64_t reserved_bytes,
+                            std::vector<boost::filesystem::path> &deferred_files);
+    std::uintmax_t getRemainingSize(const boost::filesystem::path &path) const;
+    void scheduleDeferredDistribution();
+    void handleDeferredDistribution(const boost::system::error_code &error_code);
+    bool distributeFile(const boost::filesystem::path &path);
+    bool distributeSummaries(std::vector<boost::filesystem::path> &files);
+    void removeDistributedFile(const boost::filesystem::path &path) const;
+    void quarantineFile(const boost::filesystem::path &path) const;
+    void removeDrainedPartitions(const std::vector<boost::filesystem::path> &directories) const;
+    void handleTailUpdate();
+    std::vector<boost::filesystem::path> collectTailFiles() const;
+    bool streamFileTail(const boost::filesystem::path &path);
+    bool transmitRecords(const std::string &payload);
+    void handleReportUpdate();
+
+    boost::asio::io_context &       m_io_context;
+    const boost::filesystem::path   m_output_dir;
+    const OutputLayout              m_layout;
+    const std::chrono::seconds      m_distribution_period;
+    const std::chrono::milliseconds m_tail_period;
+    const AggregationMode           m_aggregation_mode;
+    const std::chrono::seconds      m_trace_report_period;
+    const uint64_t                  m_backlog_reserve;  // upload capacity which backlog leaves for fresh data
+    TraceRecorder *const            m_trace_recorder;  // optional
+    const TraceReplay *const        m_trace_replay;    // optional, replaces periodic distribution timing
+    std::vector<TraceEvent>         m_replay_events;
+    std::size_t                     m_replay_index;
+    boost::asio::steady_timer       m_timer;
+    boost::asio::steady_timer       m_tail_timer;
+    boost::asio::steady_timer       m_report_timer;
+    boost::asio::steady_timer       m_deferred_timer;
+    uint64_t                        m_distribution_count;
+    HttpTransmitter                 m_transmitter;
+    DataAggregator                  m_aggregator;
+    LatencyTracer                   m_tracer;
+
+    // amount of bytes already streamed from files which are still being written
+    std::map<boost::filesystem::path, uint64_t> m_tail_offsets;
+
+    // files which summaries were already distributed but raw data is still pending
+    std::set<boost::filesystem::path> m_summarized_files;
+
+    // files waiting for the upload rate limiter, fresh ones keep their priority over backlog
+    std::vector<boost::filesystem::path> m_deferred_fresh_files;
+    std::vector<boost::filesystem::path> m_deferred_backlog_files;
 };
@@ -1,5 +1,6 @@
 
 #include "data_generator.h"
+#include "data_values.h"
 #include <boost/asio.hpp>
 #include <chrono>
 #include <random>
@@ -7,28 +8,27 @@
 
 //--------------------------------------------------------------------------------------------------
 
-namespace
-{
-constexpr auto min_generated_value = 0;
-constexpr auto max_generated_value = 9;
-}  // namespace
-
-//--------------------------------------------------------------------------------------------------
-
 DataGenerator::DataGenerator(boost::asio::io_context &io_context, const boost::filesystem::path &output_dir,
-                             std::chrono::milliseconds min_interval, std::chrono::milliseconds max_interval)
+                             OutputLayout layout, std::chrono::milliseconds min_interval,
+                             std::chrono::milliseconds max_interval, uint64_t seed, TraceRecorder *trace_recorder,
+                             const TraceReplay *trace_replay)
     : m_min_interval(min_interval),
       m_max_interval(max_interval),
+      m_random_engine(seed != 0 ? seed : std::random_device()()),
+      m_trace_recorder(trace_recorder),
+      m_trace_replay(trace_replay),
+      m_replay_events(trace_replay ? trace_replay->getEvents(TraceEventType::generation)
+                                   : std::vector<TraceEvent>()),
+      m_replay_index(0),
       m_timer(io_context),
       m_last_write_timestamp(),
       m_write_count(0),
-      m_file_handler(output_dir)
+      m_file_handler(output_dir, layout)
 {
     assert(min_interval.count() > 0);
     assert(min_interval <= max_interval);
 
-    m_timer.expires_from_now(randomInterval());
-    m_timer.async_wait(std::bind(&DataGenerator::writeNewData, this));
+    scheduleNextWrite();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -42,9 +42,10 @@ uint64_t DataGenerator::getWrittenValuesCount() const
 
 void DataGenerator::writeNewData()
 {
+    const auto value = m_trace_replay ? m_replay_events[m_replay_index++].value : randomValue();
+
     // start new timeout
-    m_timer.expires_from_now(randomInterval());
-    m_timer.async_wait(std::bind(&DataGenerator::writeNewData, this));
+    scheduleNextWrite();
 
     const auto now             = std::chrono::system_clock::now().time_since_epoch();
     const auto elapsed_minutes = std::chrono::duration_cast<std::chrono::minutes>(now);
@@ -53,30 +54,77 @@ void DataGenerator::writeNewData()
 
     if (m_file_handler.openFile(file_name))
     {
-        const auto &data = fmt::format("{} {}\n", randomValue(), now.count());
+        const auto &data = fmt::format("{} {}\n", value, now.count());
         m_file_handler.write(data);
         m_write_count++;
+
+        if (m_trace_recorder)
+        {
+            m_trace_recorder->record(TraceEventType::generation, value);
+        }
+
+        m_last_write_timestamp = elapsed_minutes.count();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataGenerator::scheduleNextWrite()
+{
+    if (!m_trace_replay)
+    {
+        m_timer.expires_from_now(randomInterval());
+    }
+    else if (m_replay_index < m_replay_events.size())
+    {
+        m_timer.expires_at(m_trace_replay->getScheduledTime(m_replay_events[m_replay_index]));
     }
+    else
+    {
+        spdlog::info("All {} recorded values were replayed", m_replay_events.size());
+
+        // otherwise the lock of the last replayed minute would never be released, checked once the value is written
+        m_timer.expires_from_now(std::chrono::milliseconds(0));
+        m_timer.async_wait(std::bind(&DataGenerator::closeFinishedFile, this));
+        return;
+    }
+
+    m_timer.async_wait(std::bind(&DataGenerator::writeNewData, this));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void DataGenerator::closeFinishedFile()
+{
+    const auto now             = std::chrono::system_clock::now().time_since_epoch();
+    const auto elapsed_minutes = std::chrono::duration_cast<std::chrono::minutes>(now);
+
+    // lock of the file can be released only once its minute is over
+    if (elapsed_minutes.count() > m_last_write_timestamp)
+    {
+        m_file_handler.closeCurrentFile();
+        return;
+    }
+
+    m_timer.expires_from_now(elapsed_minutes + std::chrono::minutes(1) - now);
+    m_timer.async_wait(std::bind(&DataGenerator::closeFinishedFile, this));
 }
 
 //--------------------------------------------------------------------------------------------------
 
-std::chrono::milliseconds DataGenerator::randomInterval() const
+std::chrono::milliseconds DataGenerator::randomInterval()
 {
-    static std::random_device                  random_dev;
-    static std::default_random_engine          random_engine(random_dev());
-    static std::uniform_int_distribution<long> distribution(m_min_interval.count(), m_max_interval.count());
+    std::uniform_int_distribution<long> distribution(m_min_interval.count(), m_max_interval.count());
 
-    return std::chrono::milliseconds(distribution(random_engine));
+    return std::chrono::milliseconds(distribution(m_random_engine));
 }
 
 //--------------------------------------------------------------------------------------------------
 
-short DataGenerator::randomValue() const
+short DataGenerator::randomValue()
 {
-    static std::random_device                   random_dev;
-    static std::default_random_engine           random_engine(random_dev());
-    static std::uniform_int_distribution<short> distribution(min_generated_value, max_generated_value);
+    std::uniform_int_distribution<short> distribution(data_values::min_generated_value,
+                                                      data_values::max_generated_value);
 
-    return distribution(random_engine);
+    return distribution(m_random_engine);
 }
@@ -1,10 +1,13 @@
 #pragma once
 
 #include "output_file_handler.h"
+#include "trace.h"
 #include <boost/asio/steady_timer.hpp>
 #include <boost/filesystem/path.hpp>
 #include <chrono>
+#include <random>
 #include <string>
+#include <vector>
 
 namespace boost
 {
@@ -20,17 +23,25 @@ class DataGenerator
 {
 public:
     DataGenerator(boost::asio::io_context &io_context, const boost::filesystem::path &output_dir,
-                  std::chrono::milliseconds min_interval, std::chrono::milliseconds max_interval);
+                  OutputLayout layout, std::chrono::milliseconds min_interval, std::chrono::milliseconds max_interval,
+                  uint64_t seed, TraceRecorder *trace_recorder, const TraceReplay *trace_replay);
 
     uint64_t getWrittenValuesCount() const;
 
 private:
     void                      writeNewData();
-    std::chrono::milliseconds randomInterval() const;
-    short                     randomValue() const;
+    void                      scheduleNextWrite();
+    void                      closeFinishedFile();
+    std::chrono::milliseconds randomInterval();
+    short                     randomValue();
 
     const std::chrono::milliseconds m_min_interval;
     const std::chrono::milliseconds m_max_interval;
+    std::default_random_engine      m_random_engine;
+    TraceRecorder *const            m_trace_recorder;  // optional
+    const TraceReplay *const        m_trace_replay;    // optional, replaces random generation
+    std::vector<TraceEvent>         m_replay_events;
+    std::size_t                     m_replay_index;
     boost::asio::steady_timer       m_timer;
     int64_t                         m_last_write_timestamp;  // rounded to minutes
     uint64_t                        m_write_count;
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace data_values
+{
+constexpr short min_generated_value = 0;
+constexpr short max_generated_value = 9;
+}  // namespace data_values
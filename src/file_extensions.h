@@ -4,4 +4,5 @@ namespace file_extensions
 {
 static constexpr auto data = ".dat";
 static constexpr auto lock = ".lock";
+static constexpr auto malformed = ".malformed";
 }  // file_extensions
@@ -4,7 +4,6 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/beast.hpp>
 #include <boost/beast/http.hpp>
-#include <chrono>
 #include <spdlog/spdlog.h>
 
 namespace
@@ -16,8 +15,9 @@ constexpr auto content_type    = "text/plain";
 
 //--------------------------------------------------------------------------------------------------
 
-HttpTransmitter::HttpTransmitter(boost::asio::io_service &io_context, const std::string &address, uint16_t port)
-    : m_io_context(io_context), m_address(address), m_port(port)
+HttpTransmitter::HttpTransmitter(boost::asio::io_service &io_context, const std::string &address, uint16_t port,
+                                 uint64_t rate_limit, uint64_t burst_size)
+    : m_io_context(io_context), m_address(address), m_port(port), m_rate_limiter(rate_limit, burst_size)
 {
 }
 
@@ -25,6 +25,9 @@ HttpTransmitter::HttpTransmitter(boost::asio::io_service &io_context, const std:
 
 bool HttpTransmitter::transmit(const std::string &payload)
 {
+    // transmission is never delayed here, callers check getTransmitDelay and defer payloads on their own
+    m_rate_limiter.consume(payload.size());
+
     try
     {
         auto socket = establishConnection();
@@ -33,12 +36,13 @@ bool HttpTransmitter::transmit(const std::string &payload)
             return false;
         }
 
-        sendPayload(socket.get(), payload);
+        // payload counts as delivered only once the server acknowledged it
+        const bool succeed = sendPayload(socket.get(), payload);
 
         boost::system::error_code error_code;
         socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error_code);
 
-        return true;
+        return succeed;
     }
     catch (const std::exception &e)
     {
@@ -49,6 +53,13 @@ bool HttpTransmitter::transmit(const std::string &payload)
 
 //--------------------------------------------------------------------------------------------------
 
+TokenBucket::clock::duration HttpTransmitter::getTransmitDelay(uint64_t bytes, uint64_t reserved_bytes)
+{
+    return m_rate_limiter.getDelay(bytes, reserved_bytes);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 boost::optional<boost::asio::ip::tcp::socket> HttpTransmitter::establishConnection()
 {
     boost::asio::ip::tcp::resolver resolver(m_io_context);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "token_bucket.h"
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/optional/optional_fwd.hpp>
 
@@ -16,9 +17,11 @@ class io_context;
 class HttpTransmitter
 {
 public:
-    HttpTransmitter(boost::asio::io_context &io_context, const std::string &address, uint16_t port);
+    HttpTransmitter(boost::asio::io_context &io_context, const std::string &address, uint16_t port,
+                    uint64_t rate_limit, uint64_t burst_size);
 
-    bool transmit(const std::string &payload);
+    bool                         transmit(const std::string &payload);
+    TokenBucket::clock::duration getTransmitDelay(uint64_t bytes, uint64_t reserved_bytes);
 
 private:
     boost::optional<boost::asio::ip::tcp::socket> establishConnection();
@@ -27,4 +30,5 @@ private:
     boost::asio::io_context &m_io_context;
     const std::string        m_address;
     const uint16_t           m_port;
+    TokenBucket              m_rate_limiter;
 };
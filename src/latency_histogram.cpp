@@ -0,0 +1,117 @@
+
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+// 256 sub buckets per power of two bucket give precision of more than two significant decimal digits
+constexpr unsigned    sub_bucket_bits      = 8;
+constexpr unsigned    sub_bucket_half_bits = sub_bucket_bits - 1;
+constexpr uint64_t    sub_bucket_mask      = (1UL << sub_bucket_bits) - 1;
+constexpr std::size_t sub_bucket_half      = 1UL << sub_bucket_half_bits;
+
+//--------------------------------------------------------------------------------------------------
+
+unsigned bucketOf(uint64_t value)
+{
+    unsigned highest_bit = 0;
+    for (auto v = value | sub_bucket_mask; v != 0; v >>= 1)
+    {
+        highest_bit++;
+    }
+
+    return highest_bit - sub_bucket_bits;
+}
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+LatencyHistogram::LatencyHistogram(uint64_t highest_value)
+    : m_highest_value(highest_value), m_counts(indexOf(highest_value) + 1), m_total_count(), m_max(), m_sum()
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void LatencyHistogram::record(uint64_t value)
+{
+    // values out of range are clamped rather than dropped, so they still show up in high percentiles
+    const auto clamped = std::min(value, m_highest_value);
+
+    m_counts[indexOf(clamped)]++;
+    m_total_count++;
+    m_max = std::max(m_max, clamped);
+    m_sum += static_cast<double>(clamped);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t LatencyHistogram::getCount() const
+{
+    return m_total_count;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t LatencyHistogram::getMax() const
+{
+    return m_max;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+double LatencyHistogram::getMean() const
+{
+    return m_total_count != 0 ? m_sum / static_cast<double>(m_total_count) : 0.0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const
+{
+    const auto required_count =
+        std::max(1UL, static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(m_total_count))));
+
+    uint64_t count = 0;
+    for (std::size_t index = 0; index < m_counts.size(); index++)
+    {
+        count += m_counts[index];
+        if (count >= required_count)
+        {
+            return std::min(highestValueAt(index), m_max);
+        }
+    }
+
+    return m_max;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t LatencyHistogram::indexOf(uint64_t value) const
+{
+    const auto bucket     = bucketOf(value);
+    const auto sub_bucket = value >> bucket;
+
+    // lower half of sub buckets overlaps with previous bucket except for the very first one
+    return ((static_cast<std::size_t>(bucket) + 1) << sub_bucket_half_bits) + sub_bucket - sub_bucket_half;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t LatencyHistogram::highestValueAt(std::size_t index) const
+{
+    auto bucket     = static_cast<int>(index >> sub_bucket_half_bits) - 1;
+    auto sub_bucket = (index & (sub_bucket_half - 1)) + sub_bucket_half;
+
+    if (bucket < 0)
+    {
+        sub_bucket -= sub_bucket_half;
+        bucket = 0;
+    }
+
+    const auto lowest_value = sub_bucket << bucket;
+    return lowest_value + (1UL << bucket) - 1;
+}
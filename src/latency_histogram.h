@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+/// Histogram with logarithmic buckets each split into linear sub buckets (HdrHistogram layout), which keeps
+/// relative error of recorded values below 1% while recording is a constant time array increment.
+class LatencyHistogram
+{
+public:
+    explicit LatencyHistogram(uint64_t highest_value);
+
+    void     record(uint64_t value);
+    uint64_t getCount() const;
+    uint64_t getMax() const;
+    double   getMean() const;
+    uint64_t getPercentile(double percentile) const;
+
+private:
+    std::size_t indexOf(uint64_t value) const;
+    uint64_t    highestValueAt(std::size_t index) const;
+
+    const uint64_t        m_highest_value;
+    std::vector<uint64_t> m_counts;
+    uint64_t              m_total_count;
+    uint64_t              m_max;
+    double                m_sum;
+};
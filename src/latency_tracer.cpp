@@ -0,0 +1,112 @@
+
+#include "latency_tracer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+// latencies are recorded in microseconds, anything above one day is clamped
+constexpr uint64_t highest_traced_latency = 24UL * 60 * 60 * 1000 * 1000;
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t toMicroseconds(std::chrono::system_clock::duration duration)
+{
+    const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    return microseconds > 0 ? static_cast<uint64_t>(microseconds) : 0UL;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void reportHistogram(const char *stage, const LatencyHistogram &histogram)
+{
+    spdlog::info("Latency of {} [us]: count={} mean={:.0f} p50={} p90={} p99={} p99.9={} max={}", stage,
+                 histogram.getCount(), histogram.getMean(), histogram.getPercentile(50.0),
+                 histogram.getPercentile(90.0), histogram.getPercentile(99.0), histogram.getPercentile(99.9),
+                 histogram.getMax());
+}
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+LatencyTracer::LatencyTracer(uint64_t sampling_interval)
+    : m_sampling_interval(sampling_interval),
+      m_record_count(),
+      m_open_file(highest_traced_latency),
+      m_waiting(highest_traced_latency),
+      m_upload(highest_traced_latency),
+      m_total(highest_traced_latency)
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool LatencyTracer::isEnabled() const
+{
+    return m_sampling_interval != 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void LatencyTracer::trace(const std::string &payload, time_point upload_start, time_point acknowledged)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    // each record is a line of "<value> <timestamp>"
+    for (auto *record = payload.c_str(); *record != '\0';)
+    {
+        char *value_end     = nullptr;
+        char *timestamp_end = nullptr;
+        std::strtol(record, &value_end, 10);
+        const auto timestamp = std::strtoll(value_end, &timestamp_end, 10);
+
+        if (timestamp_end != value_end && m_record_count++ % m_sampling_interval == 0)
+        {
+            traceRecord(time_point(std::chrono::system_clock::duration(timestamp)), upload_start, acknowledged);
+        }
+
+        const auto *record_end = std::strchr(timestamp_end, '\n');
+        if (record_end == nullptr)
+        {
+            break;
+        }
+
+        record = std::next(record_end);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void LatencyTracer::report() const
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    reportHistogram("records in open file", m_open_file);
+    reportHistogram("records waiting for distribution", m_waiting);
+    reportHistogram("record upload", m_upload);
+    reportHistogram("records from generation to acknowledgment", m_total);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void LatencyTracer::traceRecord(time_point generated, time_point upload_start, time_point acknowledged)
+{
+    // file stops accepting records once its minute is over, streamed records may leave it even earlier
+    const auto minute_end = std::chrono::time_point_cast<std::chrono::minutes>(generated) + std::chrono::minutes(1);
+    const auto closed     = std::min<time_point>(minute_end, upload_start);
+
+    m_open_file.record(toMicroseconds(closed - generated));
+    m_waiting.record(toMicroseconds(upload_start - closed));
+    m_upload.record(toMicroseconds(acknowledged - upload_start));
+    m_total.record(toMicroseconds(acknowledged - generated));
+}
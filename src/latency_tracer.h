@@ -0,0 +1,32 @@
+#pragma once
+
+#include "latency_histogram.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+//--------------------------------------------------------------------------------------------------
+
+/// Measures latency of distributed records from their generation until server acknowledgment, split into time
+/// spent in the open file, time waiting for distribution and upload time.
+class LatencyTracer
+{
+public:
+    using time_point = std::chrono::system_clock::time_point;
+
+    explicit LatencyTracer(uint64_t sampling_interval);
+
+    bool isEnabled() const;
+    void trace(const std::string &payload, time_point upload_start, time_point acknowledged);
+    void report() const;
+
+private:
+    void traceRecord(time_point generated, time_point upload_start, time_point acknowledged);
+
+    const uint64_t   m_sampling_interval;  // every n-th record is traced, 0 disables tracing
+    uint64_t         m_record_count;
+    LatencyHistogram m_open_file;
+    LatencyHistogram m_waiting;
+    LatencyHistogram m_upload;
+    LatencyHistogram m_total;
+};
@@ -1,12 +1,16 @@
 
 #include "data_distributor.h"
 #include "data_generator.h"
+#include "ring_ingestor.h"
+#include "trace.h"
 #include "spdlog/sinks/daily_file_sink.h"
 #include <boost/asio/io_service.hpp>
 #include <boost/filesystem/path.hpp>
 #include <csignal>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <thread>
 #include <docopt/docopt.h>
 #include <spdlog/spdlog.h>
@@ -49,15 +53,32 @@ R"(Data collection and distribution simulation process.
 
     Usage:
           data_collector --tmp-persist-dir=<path> --host=<host> --port=<port> [--dist-interval=<sec>] [--log-dir=<path>]
+                         [--partitioned-layout] [--tail-interval=<ms>] [--aggregation=<mode>]
+                         [--trace-sampling=<n>] [--trace-report-interval=<sec>] [--upload-rate=<bytes>]
+                         [--upload-burst=<bytes>] [--ingest-ring=<path>] [--ingest-capacity=<n>]
+                         [--seed=<n>] [--record-trace=<path>] [--replay-trace=<path>] [--replay-speed=<x>]
           data_collector (-h | --help)
 
     Options:
-          -h --help                 Show this screen.
-          --tmp-persist-dir=<path>  Path to directory where data will be temporarily stored.
-          --host=<host>             Name or ip address of host server.
-          --port=<port>             Port of host server.
-          --dist-interval=<sec>     Data distribution to server interval in seconds [default: 60].
-          --log-dir=<path>          Optional path to a directory where all logs will be written with rotation interval of 7days [default: ].
+          -h --help                      Show this screen.
+          --tmp-persist-dir=<path>       Path to directory where data will be temporarily stored.
+          --host=<host>                  Name or ip address of host server.
+          --port=<port>                  Port of host server.
+          --dist-interval=<sec>          Data distribution to server interval in seconds [default: 60].
+          --log-dir=<path>               Optional path to a directory where all logs will be written with rotation interval of 7days [default: ].
+          --partitioned-layout           Store data files in <day>/<hour> subdirectories of the temporary storage directory.
+          --tail-interval=<ms>           Interval in milliseconds of streaming data from files which are still being written, 0 disables streaming [default: 0].
+          --aggregation=<mode>           Distribute only raw data (raw), only per minute summaries (summary) or summaries followed by raw data (summary-first) [default: raw].
+          --trace-sampling=<n>           Trace latency of every n-th distributed record, 0 disables tracing [default: 0].
+          --trace-report-interval=<sec>  Interval in seconds of logging traced latency percentiles, 0 logs them only at shutdown [default: 300].
+          --upload-rate=<bytes>          Maximal upload rate in bytes per second, 0 means unlimited [default: 0].
+          --upload-burst=<bytes>         Amount of bytes which can be uploaded at once above the upload rate [default: 65536].
+          --ingest-ring=<path>           Collect data pushed by external processes to shared memory ring at this path instead of generating it [default: ].
+          --ingest-capacity=<n>          Capacity of the shared memory ring in records, must be a power of two [default: 65536].
+          --seed=<n>                     Seed of simulated data generation, 0 seeds it randomly [default: 0].
+          --record-trace=<path>          Record timing of generated values and distribution cycles to a trace file [default: ].
+          --replay-trace=<path>          Replay generated values and distribution cycles from a recorded trace file [default: ].
+          --replay-speed=<x>             Speed factor of trace replay, e.g. 10 replays ten times faster [default: 1].
 )";
     // clang-format on
 
@@ -85,6 +106,26 @@ void setupLogger(const std::string &log_dir_path)
     }
 }
 
+//--------------------------------------------------------------------------------------------------
+
+AggregationMode parseAggregationMode(const std::string &mode)
+{
+    if (mode == "raw")
+    {
+        return AggregationMode::raw;
+    }
+    else if (mode == "summary")
+    {
+        return AggregationMode::summary;
+    }
+    else if (mode == "summary-first")
+    {
+        return AggregationMode::summary_first;
+    }
+
+    throw std::invalid_argument("Unsupported aggregation mode: " + mode);
+}
+
 }  // namespace
 
 //--------------------------------------------------------------------------------------------------
@@ -97,23 +138,66 @@ int main(int argc, const char **argv)
 
     setupLogger(args["--log-dir"].asString());
 
-    const auto &output_dir    = args["--tmp-persist-dir"].asString();
-    const auto &address       = args["--host"].asString();
-    const auto  port          = std::stoull(args["--port"].asString());
-    const auto  dist_interval = std::stoull(args["--dist-interval"].asString());
+    const auto &output_dir            = args["--tmp-persist-dir"].asString();
+    const auto &address               = args["--host"].asString();
+    const auto  port                  = std::stoull(args["--port"].asString());
+    const auto  dist_interval         = std::stoull(args["--dist-interval"].asString());
+    const auto  tail_interval         = std::stoull(args["--tail-interval"].asString());
+    const auto  aggregation           = parseAggregationMode(args["--aggregation"].asString());
+    const auto  trace_sampling        = std::stoull(args["--trace-sampling"].asString());
+    const auto  trace_report_interval = std::stoull(args["--trace-report-interval"].asString());
+    const auto  upload_rate           = std::stoull(args["--upload-rate"].asString());
+    const auto  upload_burst          = std::stoull(args["--upload-burst"].asString());
+    const auto &ingest_ring           = args["--ingest-ring"].asString();
+    const auto  ingest_capacity       = std::stoull(args["--ingest-capacity"].asString());
+    const auto  seed                  = std::stoull(args["--seed"].asString());
+    const auto &record_trace          = args["--record-trace"].asString();
+    const auto &replay_trace          = args["--replay-trace"].asString();
+    const auto  replay_speed          = std::stod(args["--replay-speed"].asString());
+    const auto  layout                = args["--partitioned-layout"].asBool() ? OutputLayout::partitioned
+                                                                              : OutputLayout::flat;
+
+    // both are shared by generator and distributor threads, replay timeline starts right here
+    std::unique_ptr<TraceRecorder> trace_recorder;
+    std::unique_ptr<TraceReplay>   trace_replay;
+
+    if (!record_trace.empty())
+    {
+        trace_recorder = std::make_unique<TraceRecorder>(record_trace);
+    }
+
+    if (!replay_trace.empty())
+    {
+        trace_replay = std::make_unique<TraceReplay>(replay_trace, replay_speed);
+    }
 
     constexpr auto concurrency_hint = 1;
 
     boost::asio::io_context generator_context(concurrency_hint);
     boost::asio::io_context distributor_context(concurrency_hint);
 
-    std::thread generator_thread([&generator_context, &output_dir] {
+    std::thread generator_thread([&generator_context, &output_dir, layout, &ingest_ring, ingest_capacity, seed,
+                                  &trace_recorder, &trace_replay] {
         try
         {
-            DataGenerator generator(generator_context, output_dir, MIN_GENERATION_INTERVAL, MAX_GENERATION_INTERVAL);
-            generator_context.run();
-
-            spdlog::info("Total amount of written values is {}", generator.getWrittenValuesCount());
+            // data comes either from external producers or from the simulated generator, never both, so that
+            // each minute file is written by a single file handler only
+            if (!ingest_ring.empty())
+            {
+                RingIngestor ingestor(generator_context, output_dir, layout, ingest_ring, ingest_capacity);
+                generator_context.run();
+
+                spdlog::info("Total amount of ingested values is {}, rejected {}", ingestor.getIngestedValuesCount(),
+                             ingestor.getRejectedValuesCount());
+            }
+            else
+            {
+                DataGenerator generator(generator_context, output_dir, layout, MIN_GENERATION_INTERVAL,
+                                        MAX_GENERATION_INTERVAL, seed, trace_recorder.get(), trace_replay.get());
+                generator_context.run();
+
+                spdlog::info("Total amount of written values is {}", generator.getWrittenValuesCount());
+            }
         }
         catch (const std::exception &e)
         {
@@ -122,14 +206,20 @@ int main(int argc, const char **argv)
         }
     });
 
-    std::thread distributor_thread([&distributor_context, &output_dir, &address, port, dist_interval] {
+    std::thread distributor_thread([&distributor_context, &output_dir, layout, &address, port, upload_rate,
+                                    upload_burst, dist_interval, tail_interval, aggregation, trace_sampling,
+                                    trace_report_interval, &trace_recorder, &trace_replay] {
         try
         {
-            DataDistributor distributor(distributor_context, output_dir, address, static_cast<uint16_t>(port),
-                                        std::chrono::seconds(dist_interval));
+            DataDistributor distributor(distributor_context, output_dir, layout, address, static_cast<uint16_t>(port),
+                                        upload_rate, upload_burst, std::chrono::seconds(dist_interval),
+                                        std::chrono::milliseconds(tail_interval), aggregation, trace_sampling,
+                                        std::chrono::seconds(trace_report_interval), trace_recorder.get(),
+                                        trace_replay.get());
             distributor_context.run();
 
             spdlog::info("Total amount of file distributions is {}", distributor.getDistributionCount());
+            distributor.reportLatencies();
         }
         catch (const std::exception &e)
         {
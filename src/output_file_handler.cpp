@@ -8,8 +8,8 @@ namespace fs = boost::filesystem;
 
 //--------------------------------------------------------------------------------------------------
 
-OutputFileHandler::OutputFileHandler(const fs::path &output_dir)
-    : m_output_dir(output_dir), m_file_name(), m_file_stream()
+OutputFileHandler::OutputFileHandler(const fs::path &output_dir, OutputLayout layout)
+    : m_output_dir(output_dir), m_layout(layout), m_file_dir(), m_file_name(), m_file_stream()
 {
     // release any locks that were not cleaned up properly during shutdown
     releaseExistingLocks();
@@ -30,7 +30,15 @@ bool OutputFileHandler::openFile(const std::string &file_name)
     {
         closeCurrentFile();
 
-        const auto file_path = m_output_dir / fs::path(file_name + file_extensions::data);
+        const auto timestamp_in_minutes = std::strtoll(file_name.c_str(), nullptr, 10);
+        const auto file_dir             = output_layout::directoryFor(m_output_dir, m_layout, timestamp_in_minutes);
+        const auto file_path            = file_dir / fs::path(file_name + file_extensions::data);
+
+        boost::system::error_code error_code;
+        if (!fs::create_directories(file_dir, error_code) && error_code.failed())
+        {
+            spdlog::error("Failed to create directory: {}, message: {}", file_dir.string(), error_code.message());
+        }
 
         createLockFile(file_path.string() + file_extensions::lock);
 
@@ -39,6 +47,7 @@ bool OutputFileHandler::openFile(const std::string &file_name)
         if (m_file_stream.good())
         {
             spdlog::info("New file {} opened for writing", file_path.c_str());
+            m_file_dir  = file_dir;
             m_file_name = file_name;
         }
         else
@@ -52,13 +61,22 @@ bool OutputFileHandler::openFile(const std::string &file_name)
 
 //--------------------------------------------------------------------------------------------------
 
+bool OutputFileHandler::isFileOpen() const
+{
+    return m_file_stream.is_open();
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void OutputFileHandler::write(const std::string &data)
 {
     assert(m_file_stream.good());
 
+    // flush right away so that data becomes visible for live streaming before the file is closed
     m_file_stream << data;
+    m_file_stream.flush();
 
-    spdlog::debug("Data has been written to file: {}", m_file_name + file_extensions::data);
+    spdlog::debug("Data has been written to file: {}", (m_file_dir / (m_file_name + file_extensions::data)).string());
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -67,18 +85,29 @@ void OutputFileHandler::closeCurrentFile()
 {
     if (m_file_stream.is_open())
     {
-        spdlog::debug("Closing file {}", (m_output_dir / (m_file_name + file_extensions::data)).string());
+        spdlog::debug("Closing file {}", (m_file_dir / (m_file_name + file_extensions::data)).string());
 
         m_file_stream.close();
         m_file_name.clear();
 
-        releaseExistingLocks();
+        // only the partition of the closed file can hold a lock owned by this handler
+        releaseExistingLocks(m_file_dir);
     }
 }
 
 //--------------------------------------------------------------------------------------------------
 
 void OutputFileHandler::releaseExistingLocks() const
+{
+    for (const auto &dir : output_layout::collectDirectories(m_output_dir, m_layout))
+    {
+        releaseExistingLocks(dir);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void OutputFileHandler::releaseExistingLocks(const fs::path &dir) const
 {
     using dir_it = fs::directory_iterator;
 
@@ -86,7 +115,7 @@ void OutputFileHandler::releaseExistingLocks() const
     const auto elapsed_minutes              = std::chrono::duration_cast<std::chrono::minutes>(now);
     const auto current_timestamp_in_minutes = elapsed_minutes.count();
 
-    for (auto it = dir_it(m_output_dir); it != dir_it(); it++)
+    for (auto it = dir_it(dir); it != dir_it(); it++)
     {
         if (it->path().extension().extension() == file_extensions::lock)
         {
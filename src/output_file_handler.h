@@ -1,5 +1,6 @@
 #pragma once
 
+#include "output_layout.h"
 #include <boost/filesystem/path.hpp>
 #include <fstream>
 #include <string>
@@ -9,18 +10,22 @@
 class OutputFileHandler
 {
 public:
-    OutputFileHandler(const boost::filesystem::path &output_dir);
+    OutputFileHandler(const boost::filesystem::path &output_dir, OutputLayout layout);
     ~OutputFileHandler();
 
     bool openFile(const std::string &file_name);
+    bool isFileOpen() const;
     void write(const std::string &data);
+    void closeCurrentFile();
     void releaseExistingLocks() const;
 
 private:
-    void closeCurrentFile();
     void createLockFile(const boost::filesystem::path &path) const;
+    void releaseExistingLocks(const boost::filesystem::path &dir) const;
 
     const boost::filesystem::path m_output_dir;
+    const OutputLayout            m_layout;
+    boost::filesystem::path       m_file_dir;
     std::string                   m_file_name;
     std::ofstream                 m_file_stream;
 };
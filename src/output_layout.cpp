@@ -0,0 +1,102 @@
+
+#include "output_layout.h"
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <spdlog/spdlog.h>
+
+namespace fs = boost::filesystem;
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+constexpr int64_t minutes_in_hour = 60;
+constexpr int64_t hours_in_day    = 24;
+
+//--------------------------------------------------------------------------------------------------
+
+bool isPartitionName(const std::string &name)
+{
+    return !name.empty() && std::all_of(name.begin(), name.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::vector<fs::path> collectPartitions(const fs::path &dir)
+{
+    using dir_it = fs::directory_iterator;
+
+    std::vector<fs::path> partitions;
+
+    boost::system::error_code error_code;
+    for (auto it = dir_it(dir, error_code); it != dir_it(); it++)
+    {
+        // unrelated directories in the output directory are never treated as partitions
+        if (fs::is_directory(*it) && isPartitionName(it->path().filename().string()))
+        {
+            partitions.push_back(it->path());
+        }
+    }
+
+    // day and hour names are fixed width numbers, so lexicographical order is chronological
+    std::sort(partitions.begin(), partitions.end());
+
+    return partitions;
+}
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+fs::path output_layout::directoryFor(const fs::path &output_dir, OutputLayout layout, int64_t timestamp_in_minutes)
+{
+    if (layout == OutputLayout::flat)
+    {
+        return output_dir;
+    }
+
+    const auto elapsed_hours = timestamp_in_minutes / minutes_in_hour;
+    const auto elapsed_days  = elapsed_hours / hours_in_day;
+
+    return output_dir / std::to_string(elapsed_days) / fmt::format("{:02}", elapsed_hours % hours_in_day);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::vector<fs::path> output_layout::collectDirectories(const fs::path &output_dir, OutputLayout layout)
+{
+    if (layout == OutputLayout::flat)
+    {
+        return {output_dir};
+    }
+
+    // files left at the top level by an earlier run with flat layout are the oldest ones
+    std::vector<fs::path> directories{output_dir};
+
+    for (const auto &day_dir : collectPartitions(output_dir))
+    {
+        const auto &hour_dirs = collectPartitions(day_dir);
+        directories.insert(directories.end(), hour_dirs.begin(), hour_dirs.end());
+    }
+
+    return directories;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void output_layout::removeIfDrained(const fs::path &partition_dir, const fs::path &current_day_dir)
+{
+    boost::system::error_code error_code;
+
+    // non recursive removal fails on its own if anything was written meanwhile
+    if (fs::is_empty(partition_dir, error_code) && fs::remove(partition_dir, error_code))
+    {
+        spdlog::info("Removed drained partition: {}", partition_dir.string());
+
+        // writer may be creating a new hour partition of the current day at any moment
+        const auto day_dir = partition_dir.parent_path();
+        if (day_dir != current_day_dir && fs::is_empty(day_dir, error_code) && fs::remove(day_dir, error_code))
+        {
+            spdlog::info("Removed drained partition: {}", day_dir.string());
+        }
+    }
+}
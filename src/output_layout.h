@@ -0,0 +1,31 @@
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <cstdint>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+enum class OutputLayout
+{
+    flat,        // all data files are stored directly in the output directory
+    partitioned  // data files are grouped into <day>/<hour> subdirectories of the output directory
+};
+
+//--------------------------------------------------------------------------------------------------
+
+namespace output_layout
+{
+/// Returns directory in which data file of the given minute is stored.
+boost::filesystem::path directoryFor(const boost::filesystem::path &output_dir, OutputLayout layout,
+                                     int64_t timestamp_in_minutes);
+
+/// Returns all existing directories which may hold data files, output directory itself and then partitions
+/// from the oldest one. Only directories with numeric names are treated as partitions.
+std::vector<boost::filesystem::path> collectDirectories(const boost::filesystem::path &output_dir,
+                                                        OutputLayout layout);
+
+/// Removes hour partition (and its day partition when it becomes empty and is not the current day) if no files
+/// are left in it.
+void removeIfDrained(const boost::filesystem::path &partition_dir, const boost::filesystem::path &current_day_dir);
+}  // namespace output_layout
@@ -0,0 +1,98 @@
+
+#include "shm_ring.h"
+#include <chrono>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+constexpr uint64_t                  ring_capacity = 65536;
+constexpr std::size_t               batch_size    = 4096;
+constexpr std::chrono::milliseconds wait_time(100);
+
+//--------------------------------------------------------------------------------------------------
+
+void produce(const std::string &ring_path, uint64_t record_count, uint64_t &full_ring_retries)
+{
+    // every producer attaches on its own, just like a separate process would do
+    auto ring = ShmRing::open(ring_path);
+
+    for (uint64_t i = 0; i < record_count; i++)
+    {
+        const auto            now = std::chrono::system_clock::now().time_since_epoch();
+        const ShmRing::Record record{std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(),
+                                     static_cast<int16_t>(i % 10)};
+
+        while (!ring.push(record))
+        {
+            full_ring_retries++;
+            std::this_thread::yield();
+        }
+    }
+}
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+int main(int argc, const char **argv)
+{
+    if (argc != 4)
+    {
+        fmt::print("Usage: ring_benchmark <ring-path> <producers> <records-per-producer>\n");
+        return EXIT_FAILURE;
+    }
+
+    const std::string ring_path(argv[1]);
+    const auto        producer_count       = std::stoull(argv[2]);
+    const auto        records_per_producer = std::stoull(argv[3]);
+    const auto        total_records        = producer_count * records_per_producer;
+
+    auto ring = ShmRing::create(ring_path, ring_capacity);
+
+    std::vector<std::thread> producers;
+    std::vector<uint64_t>    full_ring_retries(producer_count);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < producer_count; i++)
+    {
+        producers.emplace_back(produce, ring_path, records_per_producer, std::ref(full_ring_retries[i]));
+    }
+
+    uint64_t consumed = 0;
+    int64_t  checksum = 0;
+
+    while (consumed < total_records)
+    {
+        if (ring.waitForData(wait_time))
+        {
+            consumed += ring.consume(batch_size, [&checksum](const ShmRing::Record &record) {
+                checksum += record.value;
+            });
+        }
+    }
+
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+
+    uint64_t retries = 0;
+    for (const auto count : full_ring_retries)
+    {
+        retries += count;
+    }
+
+    fmt::print("producers: {}, records: {}, time: {:.3f}s, throughput: {:.0f} records/s, full ring retries: {}, "
+               "checksum: {}\n",
+               producer_count, consumed, elapsed, static_cast<double>(consumed) / elapsed, retries, checksum);
+
+    return EXIT_SUCCESS;
+}
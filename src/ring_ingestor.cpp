@@ -0,0 +1,136 @@
+
+#include "ring_ingestor.h"
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <iterator>
+#include <map>
+#include <spdlog/spdlog.h>
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+constexpr std::size_t               max_batch_size = 4096;
+constexpr std::chrono::milliseconds max_wait_time(100);  // also bounds the delay of stopping io context
+
+//--------------------------------------------------------------------------------------------------
+
+int64_t currentMinute()
+{
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::minutes>(now).count();
+}
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+RingIngestor::RingIngestor(boost::asio::io_context &io_context, const boost::filesystem::path &output_dir,
+                           OutputLayout layout, const std::string &ring_path, uint64_t ring_capacity)
+    : m_io_context(io_context),
+      m_ring(ShmRing::create(ring_path, ring_capacity)),
+      m_ingest_count(0),
+      m_rejected_count(0),
+      m_first_writable_minute(currentMinute()),
+      m_file_handler(output_dir, layout)
+{
+    spdlog::info("Ingesting data from shared memory ring {} of capacity {}", ring_path, m_ring.getCapacity());
+
+    boost::asio::post(m_io_context, std::bind(&RingIngestor::ingestData, this));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t RingIngestor::getIngestedValuesCount() const
+{
+    return m_ingest_count;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t RingIngestor::getRejectedValuesCount() const
+{
+    return m_rejected_count;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void RingIngestor::ingestData()
+{
+    if (m_ring.waitForData(max_wait_time))
+    {
+        writeRecords();
+    }
+
+    // also when producers went idle, otherwise the last minute would stay locked until next record arrives
+    closeFinishedFile();
+
+    boost::asio::post(m_io_context, std::bind(&RingIngestor::ingestData, this));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void RingIngestor::writeRecords()
+{
+    // producers may push out of order around minute boundary, so records are grouped by file first
+    std::map<int64_t, std::string> batches;
+
+    uint64_t rejected_count = 0;
+    uint64_t late_count     = 0;
+    int64_t  current_minute = currentMinute();
+
+    const auto consumed = m_ring.consume(max_batch_size, [&](const ShmRing::Record &record) {
+        // records carry nanoseconds, files keep system clock ticks just like the generated ones
+        const auto timestamp = std::chrono::nanoseconds(record.timestamp);
+        const auto minute    = std::chrono::duration_cast<std::chrono::minutes>(timestamp).count();
+
+        // file of such minute could never be distributed, its lock would not be released, clock is read again
+        // only when the minute might have just changed
+        if (record.timestamp <= 0 || (minute > current_minute && minute > (current_minute = currentMinute())))
+        {
+            rejected_count++;
+            return;
+        }
+
+        late_count += minute < m_first_writable_minute ? 1UL : 0UL;
+
+        fmt::format_to(std::back_inserter(batches[std::max(minute, m_first_writable_minute)]), "{} {}\n",
+                       record.value, std::chrono::duration_cast<std::chrono::system_clock::duration>(timestamp).count());
+    });
+
+    m_ingest_count += consumed - rejected_count;
+    m_rejected_count += rejected_count;
+
+    if (rejected_count != 0)
+    {
+        spdlog::warn("Rejected {} records with invalid timestamp", rejected_count);
+    }
+
+    if (late_count != 0)
+    {
+        spdlog::debug("Written {} late records to file of minute {}", late_count, m_first_writable_minute);
+    }
+
+    // minutes are visited in ascending order, so no file is opened again once it was closed
+    for (const auto &batch : batches)
+    {
+        if (m_file_handler.openFile(std::to_string(batch.first)))
+        {
+            m_file_handler.write(batch.second);
+        }
+
+        m_first_writable_minute = batch.first;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void RingIngestor::closeFinishedFile()
+{
+    const auto current_minute = currentMinute();
+
+    if (m_file_handler.isFileOpen() && m_first_writable_minute < current_minute)
+    {
+        m_file_handler.closeCurrentFile();
+        m_first_writable_minute = current_minute;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "output_file_handler.h"
+#include "shm_ring.h"
+#include <boost/filesystem/path.hpp>
+#include <chrono>
+#include <string>
+
+namespace boost
+{
+namespace asio
+{
+class io_context;
+}
+}  // namespace boost
+
+//--------------------------------------------------------------------------------------------------
+
+/// Collects records pushed by external producer processes into shared memory ring and writes them in batches
+/// to the same per minute files as DataGenerator does. Once a minute file is closed it is never reopened, late
+/// records are written to the file of the current minute instead and records from the future are rejected.
+class RingIngestor
+{
+public:
+    RingIngestor(boost::asio::io_context &io_context, const boost::filesystem::path &output_dir,
+                 OutputLayout layout, const std::string &ring_path, uint64_t ring_capacity);
+
+    uint64_t getIngestedValuesCount() const;
+    uint64_t getRejectedValuesCount() const;
+
+private:
+    void ingestData();
+    void writeRecords();
+    void closeFinishedFile();
+
+    boost::asio::io_context &m_io_context;
+    ShmRing                  m_ring;
+    uint64_t                 m_ingest_count;
+    uint64_t                 m_rejected_count;
+    int64_t                  m_first_writable_minute;  // files of earlier minutes may be distributed already
+    OutputFileHandler        m_file_handler;
+};
@@ -0,0 +1,352 @@
+
+#include "shm_ring.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "ring shared between processes requires lock free atomics");
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+constexpr uint64_t    ring_magic     = 0x474e495243445f31;  // "1_DCRING"
+constexpr std::size_t cache_line     = 64;
+constexpr uint32_t    consumer_sleep = 1;
+
+//--------------------------------------------------------------------------------------------------
+
+std::system_error systemError(const std::string &message, const std::string &path)
+{
+    return std::system_error(errno, std::generic_category(), message + ": " + path);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void futexWait(std::atomic<uint32_t> &word, uint32_t expected_value, std::chrono::milliseconds timeout)
+{
+#ifdef __linux__
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    timespec   time_spec{};
+    time_spec.tv_sec  = seconds.count();
+    time_spec.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - seconds).count();
+
+    // futex is shared between processes, so FUTEX_PRIVATE_FLAG must not be used
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected_value, &time_spec, nullptr, 0);
+#else
+    // without futex fall back to short polling
+    if (word.load() == expected_value)
+    {
+        std::this_thread::sleep_for(std::min(timeout, std::chrono::milliseconds(1)));
+    }
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void futexWake(std::atomic<uint32_t> &word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+struct ShmRing::Header
+{
+    std::atomic<uint64_t> magic;  // stored last, once the ring is fully initialized
+    uint64_t              capacity;
+    uint64_t              record_size;
+
+    alignas(cache_line) std::atomic<uint64_t> producer_position;
+    alignas(cache_line) std::atomic<uint64_t> consumer_position;
+    alignas(cache_line) std::atomic<uint32_t> consumer_waiting;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t ShmRing::slotsOffset()
+{
+    return (sizeof(Header) + cache_line - 1) / cache_line * cache_line;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::size_t ShmRing::mappingSize(uint64_t capacity)
+{
+    return slotsOffset() + capacity * sizeof(Slot);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+void *mapFile(int fd, std::size_t size, const std::string &path)
+{
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        const auto error = systemError("Failed to map ring file", path);
+        close(fd);
+        throw error;
+    }
+
+    close(fd);
+    return mapping;
+}
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+ShmRing ShmRing::create(const std::string &path, uint64_t capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        throw std::invalid_argument("Ring capacity must be a power of two");
+    }
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0)
+    {
+        throw systemError("Failed to open ring file", path);
+    }
+
+    const auto size = mappingSize(capacity);
+
+    struct stat file_stat = {};
+    const bool has_expected_size = fstat(fd, &file_stat) == 0 && static_cast<std::size_t>(file_stat.st_size) == size;
+
+    // truncation to zero first guarantees that ring of different geometry is not reused
+    if (!has_expected_size && (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0))
+    {
+        const auto error = systemError("Failed to resize ring file", path);
+        close(fd);
+        throw error;
+    }
+
+    ShmRing ring(mapFile(fd, size, path), size);
+
+    // records left by previous collector run are kept if the ring is compatible
+    if (ring.m_header->magic.load(std::memory_order_acquire) == ring_magic &&
+        ring.m_header->capacity == capacity && ring.m_header->record_size == sizeof(Record))
+    {
+        return ring;
+    }
+
+    auto *header = new (ring.m_mapping) Header();
+    header->capacity    = capacity;
+    header->record_size = sizeof(Record);
+
+    for (uint64_t position = 0; position < capacity; position++)
+    {
+        new (&ring.m_slots[position]) Slot();
+        ring.m_slots[position].sequence.store(position, std::memory_order_relaxed);
+    }
+
+    header->magic.store(ring_magic, std::memory_order_release);
+
+    return ring;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ShmRing ShmRing::open(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0)
+    {
+        throw systemError("Failed to open ring file", path);
+    }
+
+    struct stat file_stat = {};
+    if (fstat(fd, &file_stat) != 0 || static_cast<std::size_t>(file_stat.st_size) < sizeof(Header))
+    {
+        close(fd);
+        throw std::runtime_error("Ring file is not initialized: " + path);
+    }
+
+    const auto size = static_cast<std::size_t>(file_stat.st_size);
+    ShmRing    ring(mapFile(fd, size, path), size);
+
+    if (ring.m_header->magic.load(std::memory_order_acquire) != ring_magic ||
+        ring.m_header->record_size != sizeof(Record) || mappingSize(ring.m_header->capacity) != size)
+    {
+        throw std::runtime_error("Ring file is not initialized or incompatible: " + path);
+    }
+
+    return ring;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ShmRing::ShmRing(void *mapping, std::size_t mapping_size)
+    : m_mapping(mapping),
+      m_mapping_size(mapping_size),
+      m_capacity(mapping_size > slotsOffset() ? (mapping_size - slotsOffset()) / sizeof(Slot) : 0),
+      m_header(static_cast<Header *>(mapping)),
+      m_slots(reinterpret_cast<Slot *>(static_cast<char *>(mapping) + slotsOffset()))
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ShmRing::ShmRing(ShmRing &&other) noexcept
+    : m_mapping(other.m_mapping),
+      m_mapping_size(other.m_mapping_size),
+      m_capacity(other.m_capacity),
+      m_header(other.m_header),
+      m_slots(other.m_slots)
+{
+    other.m_mapping = nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ShmRing::~ShmRing()
+{
+    if (m_mapping != nullptr)
+    {
+        munmap(m_mapping, m_mapping_size);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t ShmRing::getCapacity() const
+{
+    return m_capacity;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ShmRing::Slot *ShmRing::reserve()
+{
+    auto position = m_header->producer_position.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        auto &     slot     = slotAt(position);
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto lap      = static_cast<int64_t>(sequence - position);
+
+        if (lap == 0)
+        {
+            if (m_header->producer_position.compare_exchange_weak(position, position + 1,
+                                                                   std::memory_order_relaxed))
+            {
+                return &slot;
+            }
+        }
+        else if (lap < 0)
+        {
+            // consumer did not release this slot yet, ring is full
+            return nullptr;
+        }
+        else
+        {
+            position = m_header->producer_position.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ShmRing::commit(Slot *slot)
+{
+    slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    // pairs with the fence in waitForData, either consumer sees the record or producer sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_header->consumer_waiting.load(std::memory_order_relaxed) == consumer_sleep &&
+        m_header->consumer_waiting.exchange(0) == consumer_sleep)
+    {
+        futexWake(m_header->consumer_waiting);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ShmRing::push(const Record &record)
+{
+    auto *slot = reserve();
+    if (slot == nullptr)
+    {
+        return false;
+    }
+
+    slot->record = record;
+    commit(slot);
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ShmRing::waitForData(std::chrono::milliseconds timeout)
+{
+    if (hasData())
+    {
+        return true;
+    }
+
+    m_header->consumer_waiting.store(consumer_sleep);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!hasData())
+    {
+        futexWait(m_header->consumer_waiting, consumer_sleep, timeout);
+    }
+
+    m_header->consumer_waiting.store(0);
+
+    return hasData();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint64_t ShmRing::consumerPosition() const
+{
+    return m_header->consumer_position.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ShmRing::hasData() const
+{
+    const auto position = consumerPosition();
+    return slotAt(position).sequence.load(std::memory_order_acquire) == position + 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ShmRing::Slot &ShmRing::slotAt(uint64_t position) const
+{
+    return m_slots[position & (m_capacity - 1)];
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ShmRing::release(Slot &slot, uint64_t position)
+{
+    // slot becomes writable again for producers on the next lap
+    slot.sequence.store(position + m_capacity, std::memory_order_release);
+    m_header->consumer_position.store(position + 1, std::memory_order_relaxed);
+}
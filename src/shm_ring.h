@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//--------------------------------------------------------------------------------------------------
+
+/// Bounded multi producer, single consumer queue of data records living in a memory mapped file, so that
+/// external processes can hand records over to the collector without any system call on the fast path.
+/// Records are written directly into the shared slots (reserve/commit), the consumer sleeping on an empty
+/// ring is woken up via futex.
+class ShmRing
+{
+public:
+    struct Record
+    {
+        int64_t timestamp;  // nanoseconds since epoch, independent of system_clock resolution of each process
+        int16_t value;
+    };
+
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        Record                record;
+    };
+
+    /// Creates ring file of given capacity (power of two) or attaches to an existing one as a consumer.
+    static ShmRing create(const std::string &path, uint64_t capacity);
+
+    /// Attaches to a ring file created by the collector as a producer.
+    static ShmRing open(const std::string &path);
+
+    ShmRing(ShmRing &&other) noexcept;
+    ShmRing(const ShmRing &) = delete;
+    ShmRing &operator=(const ShmRing &) = delete;
+    ShmRing &operator=(ShmRing &&) = delete;
+    ~ShmRing();
+
+    uint64_t getCapacity() const;
+
+    // producer side, safe to be used from any number of threads and processes
+    Slot *reserve();
+    void  commit(Slot *slot);
+    bool  push(const Record &record);
+
+    // consumer side, only a single consumer is supported
+    bool waitForData(std::chrono::milliseconds timeout);
+    template <typename Visitor> std::size_t consume(std::size_t max_records, Visitor &&visitor);
+
+private:
+    struct Header;
+
+    ShmRing(void *mapping, std::size_t mapping_size);
+
+    static std::size_t slotsOffset();
+    static std::size_t mappingSize(uint64_t capacity);
+
+    uint64_t consumerPosition() const;
+    bool     hasData() const;
+    Slot &   slotAt(uint64_t position) const;
+    void     release(Slot &slot, uint64_t position);
+
+    void *      m_mapping;
+    std::size_t m_mapping_size;
+    uint64_t    m_capacity;  // validated size of the mapping, never read from shared memory again
+    Header *    m_header;
+    Slot *      m_slots;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+template <typename Visitor> std::size_t ShmRing::consume(std::size_t max_records, Visitor &&visitor)
+{
+    std::size_t consumed = 0;
+
+    for (; consumed < max_records; consumed++)
+    {
+        const auto position = consumerPosition();
+        auto &     slot     = slotAt(position);
+
+        // slot is readable once producer committed it for this lap of the ring
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+        {
+            break;
+        }
+
+        visitor(static_cast<const Record &>(slot.record));
+        release(slot, position);
+    }
+
+    return consumed;
+}
@@ -0,0 +1,56 @@
+
+#include "token_bucket.h"
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------------------
+
+TokenBucket::TokenBucket(uint64_t rate, uint64_t capacity)
+    : m_rate(rate), m_capacity(static_cast<double>(capacity)), m_tokens(m_capacity), m_last_refill(clock::now())
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TokenBucket::clock::duration TokenBucket::getDelay(uint64_t bytes, uint64_t reserved_bytes)
+{
+    if (m_rate == 0)
+    {
+        return clock::duration::zero();
+    }
+
+    refill();
+
+    // reserved tokens have to stay in the bucket, larger payloads only wait for it to be full and then go into debt
+    const auto reserved_tokens = std::min(static_cast<double>(reserved_bytes), m_capacity);
+    const auto required_tokens = std::min(static_cast<double>(bytes), m_capacity - reserved_tokens) + reserved_tokens;
+
+    if (m_tokens >= required_tokens)
+    {
+        return clock::duration::zero();
+    }
+
+    const std::chrono::duration<double> delay((required_tokens - m_tokens) / static_cast<double>(m_rate));
+    return std::chrono::duration_cast<clock::duration>(delay);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void TokenBucket::consume(uint64_t bytes)
+{
+    if (m_rate != 0)
+    {
+        refill();
+        m_tokens -= static_cast<double>(bytes);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void TokenBucket::refill()
+{
+    const auto now     = clock::now();
+    const auto elapsed = std::chrono::duration<double>(now - m_last_refill).count();
+
+    m_tokens      = std::min(m_capacity, m_tokens + elapsed * static_cast<double>(m_rate));
+    m_last_refill = now;
+}
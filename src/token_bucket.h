@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+
+/// Byte rate limiter which allows bursts up to the bucket capacity, rate of 0 disables limiting.
+class TokenBucket
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    TokenBucket(uint64_t rate, uint64_t capacity);
+
+    clock::duration getDelay(uint64_t bytes, uint64_t reserved_bytes);
+    void            consume(uint64_t bytes);
+
+private:
+    void refill();
+
+    const uint64_t    m_rate;  // bytes per second
+    const double      m_capacity;
+    double            m_tokens;
+    clock::time_point m_last_refill;
+};
@@ -0,0 +1,124 @@
+
+#include "trace.h"
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace fs = boost::filesystem;
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+constexpr auto trace_header     = "# data_collector trace v1";
+constexpr char generation_tag   = 'G';
+constexpr char distribution_tag = 'D';
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+
+TraceRecorder::TraceRecorder(const fs::path &path)
+    : m_start(std::chrono::steady_clock::now()), m_mutex(), m_stream(path.c_str(), std::ios::out | std::ios::trunc)
+{
+    if (!m_stream.good())
+    {
+        throw std::runtime_error("Failed to open trace file for writing: " + path.string());
+    }
+
+    m_stream << trace_header << '\n';
+    spdlog::info("Recording trace to {}", path.string());
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void TraceRecorder::record(TraceEventType type, short value)
+{
+    const auto elapsed = std::chrono::steady_clock::now() - m_start;
+    const auto offset  = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // each event is a line of "<offset in microseconds> <G|D> [value]"
+    if (type == TraceEventType::generation)
+    {
+        m_stream << offset.count() << ' ' << generation_tag << ' ' << value << '\n';
+    }
+    else
+    {
+        m_stream << offset.count() << ' ' << distribution_tag << '\n';
+    }
+
+    // keep trace usable even if the process is killed
+    m_stream.flush();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TraceReplay::TraceReplay(const fs::path &path, double speed)
+    : m_start(std::chrono::steady_clock::now()), m_speed(speed), m_events()
+{
+    if (speed <= 0)
+    {
+        throw std::invalid_argument("Trace replay speed must be positive");
+    }
+
+    std::ifstream stream(path.c_str());
+    if (!stream.is_open())
+    {
+        throw std::runtime_error("Failed to open trace file for reading: " + path.string());
+    }
+
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+
+        std::istringstream line_stream(line);
+        int64_t            offset = 0;
+        char               tag    = 0;
+        short              value  = 0;
+
+        line_stream >> offset >> tag;
+        if (tag == generation_tag)
+        {
+            line_stream >> value;
+        }
+
+        if (line_stream.fail() || (tag != generation_tag && tag != distribution_tag))
+        {
+            spdlog::warn("Skipping malformed trace line: {}", line);
+            continue;
+        }
+
+        m_events.push_back({tag == generation_tag ? TraceEventType::generation : TraceEventType::distribution,
+                            std::chrono::microseconds(offset), value});
+    }
+
+    spdlog::info("Replaying {} trace events from {} at {}x speed", m_events.size(), path.string(), speed);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::vector<TraceEvent> TraceReplay::getEvents(TraceEventType type) const
+{
+    std::vector<TraceEvent> events;
+
+    std::copy_if(m_events.begin(), m_events.end(), std::back_inserter(events),
+                 [type](const TraceEvent &event) { return event.type == type; });
+
+    return events;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::chrono::steady_clock::time_point TraceReplay::getScheduledTime(const TraceEvent &event) const
+{
+    const std::chrono::duration<double, std::micro> scaled_offset(static_cast<double>(event.offset.count()) / m_speed);
+
+    return m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(scaled_offset);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+//--------------------------------------------------------------------------------------------------
+
+enum class TraceEventType
+{
+    generation,   // value was generated and written to data file
+    distribution  // periodic distribution cycle has started
+};
+
+//--------------------------------------------------------------------------------------------------
+
+struct TraceEvent
+{
+    TraceEventType            type;
+    std::chrono::microseconds offset;  // since start of the recording
+    short                     value;   // generated value, unused for distribution
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// Appends timing of generated records and distribution cycles to a trace file, can be shared by threads.
+class TraceRecorder
+{
+public:
+    explicit TraceRecorder(const boost::filesystem::path &path);
+
+    void record(TraceEventType type, short value = 0);
+
+private:
+    const std::chrono::steady_clock::time_point m_start;
+    std::mutex                                  m_mutex;
+    std::ofstream                               m_stream;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// Recorded trace which is replayed on a common timeline starting at construction, scaled by given speed.
+class TraceReplay
+{
+public:
+    TraceReplay(const boost::filesystem::path &path, double speed);
+
+    std::vector<TraceEvent>               getEvents(TraceEventType type) const;
+    std::chrono::steady_clock::time_point getScheduledTime(const TraceEvent &event) const;
+
+private:
+    const std::chrono::steady_clock::time_point m_start;
+    const double                                m_speed;
+    std::vector<TraceEvent>                     m_events;
+};
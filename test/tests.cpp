@@ -1,4 +1,183 @@
+#include "data_aggregator.h"
+#include "data_distributor.h"
+#include "data_generator.h"
+#include "data_values.h"
+#include "file_extensions.h"
+#include "latency_histogram.h"
+#include "output_layout.h"
+#include "ring_ingestor.h"
+#include "shm_ring.h"
+#include "token_bucket.h"
+#include "trace.h"
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/fstream.hpp>
 #include <catch2/catch.hpp>
+#include <mutex>
+#include <thread>
+
+namespace fs = boost::filesystem;
+
+//--------------------------------------------------------------------------------------------------
+
+namespace
+{
+/// Creates unique temporary directory and removes it together with its content when going out of scope.
+class TemporaryDirectory
+{
+public:
+    TemporaryDirectory() : m_path(fs::temp_directory_path() / fs::unique_path())
+    {
+        fs::create_directories(m_path);
+    }
+
+    ~TemporaryDirectory()
+    {
+        boost::system::error_code error_code;
+        fs::remove_all(m_path, error_code);
+    }
+
+    const fs::path &path() const
+    {
+        return m_path;
+    }
+
+private:
+    const fs::path m_path;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+/// Http server running in its own thread which records bodies of all received requests.
+class TestServer
+{
+public:
+    explicit TestServer(boost::beast::http::status status = boost::beast::http::status::ok)
+        : m_io_context(),
+          m_acceptor(m_io_context, {boost::asio::ip::address_v4::loopback(), 0}),
+          m_status(status),
+          m_stopping(false),
+          m_mutex(),
+          m_payloads(),
+          m_thread(&TestServer::serve, this)
+    {
+    }
+
+    ~TestServer()
+    {
+        // accept is blocking, so it is woken up by one last connection
+        m_stopping = true;
+        boost::asio::ip::tcp::socket socket(m_io_context);
+        boost::system::error_code    error_code;
+        socket.connect(m_acceptor.local_endpoint(), error_code);
+        m_thread.join();
+    }
+
+    uint16_t port() const
+    {
+        return m_acceptor.local_endpoint().port();
+    }
+
+    std::vector<std::string> payloads() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_payloads;
+    }
+
+private:
+    void serve()
+    {
+        namespace http = boost::beast::http;
+
+        while (!m_stopping)
+        {
+            boost::asio::ip::tcp::socket socket(m_io_context);
+            boost::system::error_code    error_code;
+            m_acceptor.accept(socket, error_code);
+
+            if (m_stopping)
+            {
+                break;
+            }
+
+            boost::beast::flat_buffer        buffer;
+            http::request<http::string_body> request;
+            http::read(socket, buffer, request, error_code);
+
+            if (error_code.failed())
+            {
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_payloads.push_back(request.body());
+            }
+
+            http::response<http::empty_body> response(m_status, request.version());
+            response.prepare_payload();
+            http::write(socket, response, error_code);
+        }
+    }
+
+    boost::asio::io_context          m_io_context;
+    boost::asio::ip::tcp::acceptor   m_acceptor;
+    const boost::beast::http::status m_status;
+    std::atomic<bool>                m_stopping;
+    mutable std::mutex               m_mutex;
+    std::vector<std::string>         m_payloads;
+    std::thread                      m_thread;
+};
+
+//--------------------------------------------------------------------------------------------------
+
+int64_t currentMinute()
+{
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::minutes>(now).count();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void writeFile(const fs::path &path, const std::string &content)
+{
+    fs::ofstream file(path, std::ios::out | std::ios::app);
+    file << content;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+// values of all records in data files of given directory, oldest file first
+std::vector<std::string> readValues(const fs::path &dir)
+{
+    std::vector<fs::path> paths;
+    for (auto it = fs::directory_iterator(dir); it != fs::directory_iterator(); it++)
+    {
+        if (it->path().extension() == file_extensions::data)
+        {
+            paths.push_back(it->path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<std::string> values;
+    for (const auto &path : paths)
+    {
+        fs::ifstream file(path);
+        std::string  value;
+        std::string  timestamp;
+        while (file >> value >> timestamp)
+        {
+            values.push_back(value);
+        }
+    }
+
+    return values;
+}
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
 
 TEST_CASE("Test data generation & distribution")
 {
@@ -7,3 +186,706 @@ TEST_CASE("Test data generation & distribution")
     // 2. start an http server to verify that some data is being distributed
     // 3. Check that data files are being created and later deleted
 }
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Output layout maps minutes to directories")
+{
+    const fs::path output_dir("out");
+
+    SECTION("flat layout keeps every file in output directory")
+    {
+        REQUIRE(output_layout::directoryFor(output_dir, OutputLayout::flat, 0) == output_dir);
+        REQUIRE(output_layout::directoryFor(output_dir, OutputLayout::flat, 26000000) == output_dir);
+    }
+
+    SECTION("partitioned layout groups files by day and hour")
+    {
+        REQUIRE(output_layout::directoryFor(output_dir, OutputLayout::partitioned, 0) == output_dir / "0" / "00");
+        REQUIRE(output_layout::directoryFor(output_dir, OutputLayout::partitioned, 59) == output_dir / "0" / "00");
+        REQUIRE(output_layout::directoryFor(output_dir, OutputLayout::partitioned, 60) == output_dir / "0" / "01");
+        REQUIRE(output_layout::directoryFor(output_dir, OutputLayout::partitioned, 1439) == output_dir / "0" / "23");
+        REQUIRE(output_layout::directoryFor(output_dir, OutputLayout::partitioned, 1500) == output_dir / "1" / "01");
+    }
+
+    SECTION("minutes of the same hour share partition")
+    {
+        const auto minute = 26000000;
+        REQUIRE(output_layout::directoryFor(output_dir, OutputLayout::partitioned, minute) ==
+                output_layout::directoryFor(output_dir, OutputLayout::partitioned, minute - minute % 60 + 59));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Output layout collects output directory and partitions oldest first")
+{
+    TemporaryDirectory output_dir;
+
+    fs::create_directories(output_dir.path() / "18055" / "23");
+    fs::create_directories(output_dir.path() / "18056" / "00");
+    fs::create_directories(output_dir.path() / "18055" / "07");
+    fs::create_directories(output_dir.path() / "18055" / "notes");
+    fs::create_directories(output_dir.path() / "backup" / "01");
+
+    SECTION("flat layout")
+    {
+        const std::vector<fs::path> expected{output_dir.path()};
+        REQUIRE(output_layout::collectDirectories(output_dir.path(), OutputLayout::flat) == expected);
+    }
+
+    SECTION("partitioned layout still includes files left by flat layout, but no unrelated directories")
+    {
+        const std::vector<fs::path> expected{output_dir.path(), output_dir.path() / "18055" / "07",
+                                             output_dir.path() / "18055" / "23", output_dir.path() / "18056" / "00"};
+        REQUIRE(output_layout::collectDirectories(output_dir.path(), OutputLayout::partitioned) == expected);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Output layout removes drained partitions")
+{
+    TemporaryDirectory output_dir;
+
+    const auto previous_day_hour = output_dir.path() / "18055" / "23";
+    const auto current_day_hour  = output_dir.path() / "18056" / "00";
+    const auto current_day       = current_day_hour.parent_path();
+    fs::create_directories(previous_day_hour);
+    fs::create_directories(current_day_hour);
+
+    SECTION("partition with files is kept")
+    {
+        fs::ofstream(previous_day_hour / "26000000.dat") << "1 1\n";
+        output_layout::removeIfDrained(previous_day_hour, current_day);
+
+        REQUIRE(fs::exists(previous_day_hour));
+    }
+
+    SECTION("empty day is removed together with its last hour")
+    {
+        output_layout::removeIfDrained(previous_day_hour, current_day);
+
+        REQUIRE_FALSE(fs::exists(previous_day_hour.parent_path()));
+    }
+
+    SECTION("current day is kept even when empty")
+    {
+        output_layout::removeIfDrained(current_day_hour, current_day);
+
+        REQUIRE_FALSE(fs::exists(current_day_hour));
+        REQUIRE(fs::exists(current_day));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Distributor streams tail of file which is still being written")
+{
+    constexpr std::chrono::milliseconds tail_period(10);
+    constexpr std::chrono::milliseconds run_time(200);
+
+    TemporaryDirectory      output_dir;
+    TestServer              server;
+    boost::asio::io_context io_context;
+
+    const auto path      = output_dir.path() / (std::to_string(currentMinute()) + file_extensions::data);
+    const auto lock_path = fs::path(path.string() + file_extensions::lock);
+    writeFile(lock_path, "");
+
+    const auto createDistributor = [&]() {
+        return std::make_unique<DataDistributor>(io_context, output_dir.path(), OutputLayout::flat, "127.0.0.1",
+                                                 server.port(), 0, 65536, std::chrono::seconds(3600), tail_period,
+                                                 AggregationMode::raw, 0, std::chrono::seconds(0), nullptr, nullptr);
+    };
+
+    SECTION("only complete lines are streamed and the rest follows once the file is unlocked")
+    {
+        writeFile(path, "1 100\n2 200\n3 3");
+        const auto distributor = createDistributor();
+        io_context.run_for(run_time);
+
+        REQUIRE(server.payloads() == std::vector<std::string>{"1 100\n2 200\n"});
+
+        // no new complete line, nothing is streamed
+        io_context.run_for(run_time);
+        REQUIRE(server.payloads().size() == 1);
+
+        writeFile(path, "00\n4 400\n");
+        fs::remove(lock_path);
+        io_context.run_for(run_time);
+
+        REQUIRE(server.payloads() == std::vector<std::string>{"1 100\n2 200\n", "3 300\n4 400\n"});
+        REQUIRE_FALSE(fs::exists(path));
+    }
+
+    SECTION("fully streamed file is removed without another upload")
+    {
+        writeFile(path, "5 500\n");
+        const auto distributor = createDistributor();
+        io_context.run_for(run_time);
+
+        REQUIRE(server.payloads() == std::vector<std::string>{"5 500\n"});
+
+        fs::remove(lock_path);
+        io_context.run_for(run_time);
+
+        REQUIRE(server.payloads().size() == 1);
+        REQUIRE_FALSE(fs::exists(path));
+    }
+
+    SECTION("file unlocked before it was streamed is distributed as a whole")
+    {
+        fs::remove(lock_path);
+        writeFile(path, "6 600\n");
+        const auto distributor = createDistributor();
+
+        // initial distribution happens right in the constructor
+        REQUIRE(server.payloads() == std::vector<std::string>{"6 600\n"});
+        REQUIRE_FALSE(fs::exists(path));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Distributor shapes uploads to upload rate")
+{
+    constexpr uint64_t                  upload_burst = 100;
+    constexpr std::chrono::milliseconds tail_period(10);
+
+    TemporaryDirectory      output_dir;
+    TestServer              server;
+    boost::asio::io_context io_context;
+
+    const auto pathFor = [&](int64_t minutes) {
+        return output_dir.path() / (std::to_string(minutes) + file_extensions::data);
+    };
+    const auto createDistributor = [&](uint64_t upload_rate) {
+        return std::make_unique<DataDistributor>(io_context, output_dir.path(), OutputLayout::flat, "127.0.0.1",
+                                                 server.port(), upload_rate, upload_burst, std::chrono::seconds(3600),
+                                                 tail_period, AggregationMode::raw, 0, std::chrono::seconds(0),
+                                                 nullptr, nullptr);
+    };
+
+    SECTION("backlog is drained at upload rate instead of waiting for the next distribution")
+    {
+        const std::vector<std::string> backlog(3, std::string(39, '1') + "\n");
+        for (int64_t i = 0; i < 3; i++)
+        {
+            writeFile(pathFor(26000000 + i), backlog[static_cast<std::size_t>(i)]);
+        }
+
+        // only the first file leaves half of the burst available right away
+        const auto distributor = createDistributor(1000);
+        REQUIRE(server.payloads().size() == 1);
+
+        io_context.run_for(std::chrono::milliseconds(300));
+        REQUIRE(server.payloads() == backlog);
+    }
+
+    SECTION("backlog waits while fresh file does")
+    {
+        const auto fresh_first  = std::string(39, '1') + "\n";
+        const auto fresh_second = std::string(94, '2') + "\n";
+        const auto backlog      = std::string(4, '3') + "\n";
+        writeFile(pathFor(currentMinute() - 1), fresh_first);
+        writeFile(pathFor(currentMinute()), fresh_second);
+        writeFile(pathFor(26000000), backlog);
+
+        // tokens left after the first fresh file would suffice for the backlog but not for the second fresh file
+        const auto distributor = createDistributor(1000);
+        REQUIRE(server.payloads() == std::vector<std::string>{fresh_first});
+
+        io_context.run_for(std::chrono::milliseconds(300));
+        REQUIRE(server.payloads() == std::vector<std::string>{fresh_first, fresh_second, backlog});
+    }
+
+    SECTION("file unlocked after streaming does not drop other deferred files")
+    {
+        const auto fresh_first  = std::string(39, '1') + "\n";
+        const auto fresh_second = std::string(94, '2') + "\n";
+        const auto tail_path    = pathFor(currentMinute());
+        const auto lock_path    = fs::path(tail_path.string() + file_extensions::lock);
+        writeFile(pathFor(currentMinute() - 2), fresh_first);
+        writeFile(pathFor(currentMinute() - 1), fresh_second);
+        writeFile(lock_path, "");
+        writeFile(tail_path, "1 100\n");
+
+        const auto distributor = createDistributor(200);
+        io_context.run_for(std::chrono::milliseconds(50));
+        REQUIRE(server.payloads() == std::vector<std::string>{fresh_first, "1 100\n"});
+
+        writeFile(tail_path, "2 200\n");
+        fs::remove(lock_path);
+        io_context.run_for(std::chrono::milliseconds(600));
+
+        REQUIRE(server.payloads() == std::vector<std::string>{fresh_first, "1 100\n", fresh_second, "2 200\n"});
+        REQUIRE_FALSE(fs::exists(tail_path));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Distributor moves file which cannot be summarized aside")
+{
+    TemporaryDirectory      output_dir;
+    TestServer              server;
+    boost::asio::io_context io_context;
+
+    const auto partition_dir  = output_dir.path() / "18055" / "23";
+    const auto valid_path     = partition_dir / ("26000000" + std::string(file_extensions::data));
+    const auto malformed_path = partition_dir / ("26000001" + std::string(file_extensions::data));
+    fs::create_directories(partition_dir);
+    writeFile(valid_path, "3 1560000000000000000\n5 1560000001000000000\n");
+    writeFile(malformed_path, "3 1560000060000000000\ngarbage\n");
+
+    // initial distribution happens right in the constructor
+    const DataDistributor distributor(io_context, output_dir.path(), OutputLayout::partitioned, "127.0.0.1",
+                                      server.port(), 0, 65536, std::chrono::seconds(3600),
+                                      std::chrono::milliseconds(0), AggregationMode::summary, 0,
+                                      std::chrono::seconds(0), nullptr, nullptr);
+
+    REQUIRE(server.payloads() ==
+            std::vector<std::string>{"summary 26000000 count=2 min=3 max=5 mean=4.000 histogram=0,0,0,1,0,1,0,0,0,0\n"});
+    REQUIRE_FALSE(fs::exists(valid_path));
+    REQUIRE_FALSE(fs::exists(malformed_path));
+    REQUIRE(fs::exists(output_dir.path() / ("26000001" + std::string(file_extensions::data) +
+                                            file_extensions::malformed)));
+    REQUIRE_FALSE(fs::exists(partition_dir.parent_path()));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Data aggregator summarizes minute file in a single pass")
+{
+    TemporaryDirectory   output_dir;
+    const DataAggregator aggregator(data_values::min_generated_value, data_values::max_generated_value);
+    const auto           path = output_dir.path() / "26000000.dat";
+    fs::ofstream         file(path);
+
+    SECTION("statistics of all records")
+    {
+        file << "3 1560000000000000000\n0 1560000001000000000\n9 1560000002000000000\n3 1560000003000000000\n";
+        file.close();
+
+        const auto summary = aggregator.aggregate(path);
+        REQUIRE(summary.is_initialized());
+        REQUIRE(summary->minute == 26000000);
+        REQUIRE(summary->count == 4);
+        REQUIRE(summary->min == 0);
+        REQUIRE(summary->max == 9);
+        REQUIRE(summary->mean == Approx(3.75));
+
+        const std::array<uint64_t, MinuteSummary::histogram_buckets> expected_histogram{1, 0, 0, 2, 0, 0, 0, 0, 0, 1};
+        REQUIRE(summary->histogram == expected_histogram);
+        REQUIRE(summary->format() ==
+                "summary 26000000 count=4 min=0 max=9 mean=3.750 histogram=1,0,0,2,0,0,0,0,0,1\n");
+    }
+
+    SECTION("empty file")
+    {
+        file.close();
+
+        const auto summary = aggregator.aggregate(path);
+        REQUIRE(summary.is_initialized());
+        REQUIRE(summary->count == 0);
+        REQUIRE(summary->min == 0);
+        REQUIRE(summary->max == 0);
+    }
+
+    SECTION("malformed record fails the whole file")
+    {
+        file << "3 1560000000000000000\ngarbage\n4 1560000002000000000\n";
+        file.close();
+
+        REQUIRE_FALSE(aggregator.aggregate(path).is_initialized());
+    }
+
+    SECTION("missing file")
+    {
+        file.close();
+        boost::filesystem::remove(path);
+
+        REQUIRE_FALSE(aggregator.aggregate(path).is_initialized());
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Latency histogram percentiles")
+{
+    constexpr uint64_t highest_value = 3600000000;  // hour in microseconds
+    LatencyHistogram   histogram(highest_value);
+
+    SECTION("empty histogram")
+    {
+        REQUIRE(histogram.getCount() == 0);
+        REQUIRE(histogram.getMax() == 0);
+        REQUIRE(histogram.getMean() == 0.0);
+        REQUIRE(histogram.getPercentile(99.0) == 0);
+    }
+
+    SECTION("small values are recorded exactly")
+    {
+        for (uint64_t value = 0; value < 256; value++)
+        {
+            histogram.record(value);
+        }
+
+        REQUIRE(histogram.getCount() == 256);
+        REQUIRE(histogram.getMax() == 255);
+        REQUIRE(histogram.getMean() == Approx(127.5));
+        REQUIRE(histogram.getPercentile(0.0) == 0);
+        REQUIRE(histogram.getPercentile(50.0) == 127);
+        REQUIRE(histogram.getPercentile(100.0) == 255);
+    }
+
+    SECTION("large values stay within relative error bound")
+    {
+        constexpr uint64_t count = 1000000;
+        for (uint64_t value = 1; value <= count; value++)
+        {
+            histogram.record(value * 1000);
+        }
+
+        REQUIRE(histogram.getCount() == count);
+        REQUIRE(histogram.getMax() == count * 1000);
+        REQUIRE(histogram.getMean() == Approx(500000.5 * 1000));
+
+        for (const auto percentile : {1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 99.99})
+        {
+            const auto exact    = static_cast<double>(count) * 1000 * percentile / 100.0;
+            const auto reported = static_cast<double>(histogram.getPercentile(percentile));
+
+            // reported value is the upper bound of the sub bucket, so it never underestimates
+            REQUIRE(reported >= exact);
+            REQUIRE(reported <= exact * 1.01);
+        }
+
+        REQUIRE(histogram.getPercentile(100.0) == count * 1000);
+    }
+
+    SECTION("values out of range are clamped to highest value")
+    {
+        histogram.record(10);
+        histogram.record(highest_value * 2);
+
+        REQUIRE(histogram.getCount() == 2);
+        REQUIRE(histogram.getMax() == highest_value);
+        REQUIRE(histogram.getPercentile(100.0) == highest_value);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Token bucket shapes uploads")
+{
+    using seconds = std::chrono::duration<double>;
+
+    // refill during the test itself is negligible at this rate, so delays are checked with small margin
+    constexpr uint64_t rate     = 1000;
+    constexpr uint64_t capacity = 1000;
+    TokenBucket        bucket(rate, capacity);
+
+    SECTION("zero rate disables limiting")
+    {
+        TokenBucket unlimited(0, capacity);
+        unlimited.consume(capacity * 100);
+
+        REQUIRE(unlimited.getDelay(capacity * 100, 0) == TokenBucket::clock::duration::zero());
+    }
+
+    SECTION("full bucket allows burst")
+    {
+        REQUIRE(bucket.getDelay(capacity, 0) == TokenBucket::clock::duration::zero());
+    }
+
+    SECTION("empty bucket delays by time needed to refill")
+    {
+        bucket.consume(capacity);
+
+        const auto delay = seconds(bucket.getDelay(500, 0)).count();
+        REQUIRE(delay > 0.45);
+        REQUIRE(delay <= 0.5);
+    }
+
+    SECTION("payload larger than capacity waits only for full bucket and then goes into debt")
+    {
+        REQUIRE(bucket.getDelay(capacity * 3, 0) == TokenBucket::clock::duration::zero());
+
+        bucket.consume(capacity * 3);
+
+        // debt of two capacities has to be paid back before the next byte
+        const auto delay = seconds(bucket.getDelay(1, 0)).count();
+        REQUIRE(delay > 1.95);
+        REQUIRE(delay <= 2.001);
+    }
+
+    SECTION("reserved bytes have to stay in the bucket")
+    {
+        bucket.consume(100);
+
+        REQUIRE(bucket.getDelay(capacity / 2 - 100, capacity / 2) == TokenBucket::clock::duration::zero());
+        REQUIRE(bucket.getDelay(capacity / 2, capacity / 2) > TokenBucket::clock::duration::zero());
+
+        bucket.consume(capacity / 2 - 100);
+
+        // reserve is still available for payloads which do not need to keep it
+        REQUIRE(bucket.getDelay(capacity / 2, 0) == TokenBucket::clock::duration::zero());
+        REQUIRE(bucket.getDelay(1, capacity / 2) > TokenBucket::clock::duration::zero());
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Shared memory ring hands records over to consumer")
+{
+    TemporaryDirectory ring_dir;
+    const auto         ring_path = (ring_dir.path() / "ring").string();
+    constexpr uint64_t capacity  = 8;
+
+    auto ring     = ShmRing::create(ring_path, capacity);
+    auto producer = ShmRing::open(ring_path);
+
+    std::vector<ShmRing::Record> consumed;
+    const auto collect = [&consumed](const ShmRing::Record &record) { consumed.push_back(record); };
+
+    SECTION("capacity must be a power of two")
+    {
+        REQUIRE_THROWS_AS(ShmRing::create((ring_dir.path() / "invalid").string(), 12), std::invalid_argument);
+        REQUIRE(ring.getCapacity() == capacity);
+        REQUIRE(producer.getCapacity() == capacity);
+    }
+
+    SECTION("records are consumed in push order")
+    {
+        for (int16_t value = 0; value < 5; value++)
+        {
+            REQUIRE(producer.push({value * 10, value}));
+        }
+
+        REQUIRE(ring.consume(3, collect) == 3);
+        REQUIRE(ring.consume(10, collect) == 2);
+        REQUIRE(ring.consume(10, collect) == 0);
+
+        REQUIRE(consumed.size() == 5);
+        for (int16_t value = 0; value < 5; value++)
+        {
+            REQUIRE(consumed[static_cast<std::size_t>(value)].value == value);
+            REQUIRE(consumed[static_cast<std::size_t>(value)].timestamp == value * 10);
+        }
+    }
+
+    SECTION("full ring rejects records until consumer releases slots")
+    {
+        for (uint64_t i = 0; i < capacity; i++)
+        {
+            REQUIRE(producer.push({1, 1}));
+        }
+
+        REQUIRE(producer.reserve() == nullptr);
+        REQUIRE_FALSE(producer.push({2, 2}));
+
+        REQUIRE(ring.consume(1, collect) == 1);
+        REQUIRE(producer.push({3, 3}));
+        REQUIRE_FALSE(producer.push({4, 4}));
+
+        REQUIRE(ring.consume(capacity * 2, collect) == capacity);
+        REQUIRE(consumed.back().value == 3);
+    }
+
+    SECTION("reserved slot is visible only once committed")
+    {
+        auto *slot = producer.reserve();
+        REQUIRE(slot != nullptr);
+        slot->record = {5, 5};
+
+        REQUIRE_FALSE(ring.waitForData(std::chrono::milliseconds(0)));
+
+        producer.commit(slot);
+
+        REQUIRE(ring.waitForData(std::chrono::milliseconds(0)));
+        REQUIRE(ring.consume(1, collect) == 1);
+        REQUIRE(consumed.front().value == 5);
+    }
+
+    SECTION("waiting for data times out on empty ring")
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        REQUIRE_FALSE(ring.waitForData(std::chrono::milliseconds(50)));
+        REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(40));
+    }
+
+    SECTION("waiting consumer is woken up by producer")
+    {
+        std::thread producer_thread([&ring_path] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            ShmRing::open(ring_path).push({6, 6});
+        });
+
+        const auto start    = std::chrono::steady_clock::now();
+        const bool has_data = ring.waitForData(std::chrono::seconds(10));
+        const auto elapsed  = std::chrono::steady_clock::now() - start;
+        producer_thread.join();
+
+        REQUIRE(has_data);
+        REQUIRE(elapsed < std::chrono::seconds(5));
+        REQUIRE(ring.consume(1, collect) == 1);
+        REQUIRE(consumed.front().value == 6);
+    }
+
+    SECTION("collector restart reattaches to records left in the ring")
+    {
+        REQUIRE(producer.push({7, 7}));
+        REQUIRE(producer.push({8, 8}));
+        REQUIRE(ring.consume(1, collect) == 1);
+
+        auto restarted = ShmRing::create(ring_path, capacity);
+        REQUIRE(restarted.consume(10, collect) == 1);
+        REQUIRE(consumed.back().value == 8);
+
+        // producers attached before the restart keep working
+        REQUIRE(producer.push({9, 9}));
+        REQUIRE(restarted.consume(10, collect) == 1);
+        REQUIRE(consumed.back().value == 9);
+    }
+
+    SECTION("ring of different geometry is recreated")
+    {
+        REQUIRE(producer.push({10, 10}));
+
+        auto resized = ShmRing::create(ring_path, capacity * 2);
+        REQUIRE(resized.getCapacity() == capacity * 2);
+        REQUIRE(resized.consume(10, collect) == 0);
+    }
+
+    SECTION("producer cannot attach to missing ring")
+    {
+        REQUIRE_THROWS(ShmRing::open((ring_dir.path() / "missing").string()));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Ring ingestor writes nanosecond record timestamps as system clock ticks")
+{
+    TemporaryDirectory      output_dir;
+    boost::asio::io_context io_context;
+
+    const auto   ring_path = (output_dir.path() / "ring").string();
+    RingIngestor ingestor(io_context, output_dir.path(), OutputLayout::flat, ring_path, 8);
+
+    const auto now    = std::chrono::system_clock::now().time_since_epoch();
+    const auto now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now);
+    const auto minute = std::chrono::duration_cast<std::chrono::minutes>(now);
+    const auto future = std::chrono::duration_cast<std::chrono::nanoseconds>(minute + std::chrono::minutes(2));
+
+    auto producer = ShmRing::open(ring_path);
+    REQUIRE(producer.push({now_ns.count(), 5}));
+    REQUIRE(producer.push({future.count(), 6}));
+    REQUIRE(producer.push({0, 7}));
+    io_context.run_for(std::chrono::milliseconds(50));
+
+    REQUIRE(ingestor.getIngestedValuesCount() == 1);
+    REQUIRE(ingestor.getRejectedValuesCount() == 2);
+
+    fs::ifstream      file(output_dir.path() / (std::to_string(minute.count()) + file_extensions::data));
+    const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const auto        ticks = std::chrono::duration_cast<std::chrono::system_clock::duration>(now_ns).count();
+    REQUIRE(content == "5 " + std::to_string(ticks) + "\n");
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Trace replay schedules recorded events")
+{
+    TemporaryDirectory trace_dir;
+    const auto         trace_path = trace_dir.path() / "trace";
+    writeFile(trace_path, "# recorded trace\n0 G 5\n1500 D\nbogus\n2000 X\n3000 G\n\n4000 G 7\n");
+
+    SECTION("malformed lines are skipped")
+    {
+        const TraceReplay replay(trace_path, 1);
+
+        const auto generation = replay.getEvents(TraceEventType::generation);
+        REQUIRE(generation.size() == 2);
+        REQUIRE(generation[0].offset == std::chrono::microseconds(0));
+        REQUIRE(generation[0].value == 5);
+        REQUIRE(generation[1].offset == std::chrono::microseconds(4000));
+        REQUIRE(generation[1].value == 7);
+
+        const auto distribution = replay.getEvents(TraceEventType::distribution);
+        REQUIRE(distribution.size() == 1);
+        REQUIRE(distribution[0].offset == std::chrono::microseconds(1500));
+    }
+
+    SECTION("offsets are scaled by replay speed")
+    {
+        const auto        before = std::chrono::steady_clock::now();
+        const TraceReplay replay(trace_path, 4);
+        const auto        after = std::chrono::steady_clock::now();
+
+        const auto generation = replay.getEvents(TraceEventType::generation);
+        const auto start      = replay.getScheduledTime(generation[0]);
+        REQUIRE(start >= before);
+        REQUIRE(start <= after);
+        REQUIRE(replay.getScheduledTime(generation[1]) - start == std::chrono::microseconds(1000));
+    }
+
+    SECTION("speed must be positive")
+    {
+        REQUIRE_THROWS_AS(TraceReplay(trace_path, 0), std::invalid_argument);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_CASE("Data generator")
+{
+    TemporaryDirectory      output_dir;
+    boost::asio::io_context io_context;
+
+    constexpr std::chrono::milliseconds interval(1);
+    constexpr std::chrono::milliseconds run_time(100);
+
+    SECTION("seeded generation is deterministic")
+    {
+        const auto first_dir  = output_dir.path() / "first";
+        const auto second_dir = output_dir.path() / "second";
+        fs::create_directories(first_dir);
+        fs::create_directories(second_dir);
+
+        const DataGenerator first(io_context, first_dir, OutputLayout::flat, interval, interval * 2, 42, nullptr,
+                                  nullptr);
+        const DataGenerator second(io_context, second_dir, OutputLayout::flat, interval, interval * 2, 42, nullptr,
+                                   nullptr);
+        io_context.run_for(run_time);
+
+        // both generate the same sequence of values, only their count depends on timing
+        auto first_values  = readValues(first_dir);
+        auto second_values = readValues(second_dir);
+        const auto count   = std::min(first_values.size(), second_values.size());
+        REQUIRE(count >= 10);
+
+        first_values.resize(count);
+        second_values.resize(count);
+        REQUIRE(first_values == second_values);
+    }
+
+    SECTION("recorded values are replayed")
+    {
+        const auto trace_path = output_dir.path() / "trace";
+        writeFile(trace_path, "0 G 3\n1000 D\n2000 G 4\n");
+        const TraceReplay replay(trace_path, 1);
+
+        const auto          data_dir = output_dir.path() / "data";
+        fs::create_directories(data_dir);
+        const DataGenerator generator(io_context, data_dir, OutputLayout::flat, interval, interval, 0, nullptr,
+                                      &replay);
+        io_context.run_for(run_time);
+
+        REQUIRE(generator.getWrittenValuesCount() == 2);
+        REQUIRE(readValues(data_dir) == std::vector<std::string>{"3", "4"});
+    }
+}
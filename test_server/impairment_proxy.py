@@ -0,0 +1,152 @@
+#!/usr/bin/python3
+
+"""TCP proxy placed between data_collector and the test server which impairs the network on purpose.
+
+It can delay forwarded data, cap bandwidth, reset connections and answer with http errors, so that backlog
+draining and recovery can be benchmarked reproducibly on a single machine. Random decisions are seeded.
+"""
+
+import argparse
+import asyncio
+import random
+import socket
+import struct
+import time
+
+ERROR_RESPONSE = b"HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+CHUNK_SIZE = 4096
+
+
+class TokenBucket:
+    """Byte rate limiter shared by all connections in one direction, rate of 0 disables limiting."""
+
+    def __init__(self, rate):
+        self.rate = rate
+        self.tokens = rate
+        self.last_refill = time.monotonic()
+
+    async def consume(self, amount):
+        if self.rate == 0:
+            return
+
+        now = time.monotonic()
+        self.tokens = min(self.rate, self.tokens + (now - self.last_refill) * self.rate)
+        self.last_refill = now
+        self.tokens -= amount
+
+        if self.tokens < 0:
+            await asyncio.sleep(-self.tokens / self.rate)
+
+
+async def read_request(reader):
+    headers = await reader.readuntil(b"\r\n\r\n")
+    content_length = 0
+    for line in headers.split(b"\r\n"):
+        name, _, value = line.partition(b":")
+        if name.strip().lower() == b"content-length":
+            content_length = int(value)
+    return headers + await reader.readexactly(content_length)
+
+
+async def receive(reader, queue, latency):
+    # chunks are delayed as they flow, so latency does not limit throughput of the pipeline
+    loop = asyncio.get_running_loop()
+    try:
+        while True:
+            data = await reader.read(CHUNK_SIZE)
+            if not data:
+                break
+            queue.put_nowait((loop.time() + latency, data))
+    except (ConnectionError, asyncio.IncompleteReadError):
+        pass
+    finally:
+        queue.put_nowait((loop.time() + latency, None))
+
+
+async def deliver(writer, queue, bucket):
+    loop = asyncio.get_running_loop()
+    try:
+        while True:
+            deadline, data = await queue.get()
+            await asyncio.sleep(max(0.0, deadline - loop.time()))
+            if data is None:
+                break
+            await bucket.consume(len(data))
+            writer.write(data)
+            await writer.drain()
+    except ConnectionError:
+        pass
+    finally:
+        writer.close()
+
+
+async def forward(reader, writer, latency, bucket):
+    queue = asyncio.Queue()
+    await asyncio.gather(receive(reader, queue, latency), deliver(writer, queue, bucket))
+
+
+def reset(writer):
+    # zero linger makes close send RST instead of FIN
+    sock = writer.get_extra_info("socket")
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+    writer.transport.abort()
+
+
+async def handle_connection(args, rng, buckets, client_reader, client_writer):
+    roll = rng.random()
+
+    if roll < args.error_rate:
+        await read_request(client_reader)
+        await asyncio.sleep(args.latency)
+        client_writer.write(ERROR_RESPONSE)
+        await client_writer.drain()
+        client_writer.close()
+        print("Answered with error response", flush=True)
+        return
+
+    if roll < args.error_rate + args.reset_rate:
+        await client_reader.read(CHUNK_SIZE)
+        reset(client_writer)
+        print("Reset connection", flush=True)
+        return
+
+    try:
+        server_reader, server_writer = await asyncio.open_connection(args.target_host, args.target_port)
+    except OSError as error:
+        print("Failed to connect to target: {}".format(error), flush=True)
+        reset(client_writer)
+        return
+
+    await asyncio.gather(forward(client_reader, server_writer, args.latency, buckets[0]),
+                         forward(server_reader, client_writer, args.latency, buckets[1]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--listen-host", default="localhost")
+    parser.add_argument("--listen-port", type=int, required=True)
+    parser.add_argument("--target-host", default="localhost")
+    parser.add_argument("--target-port", type=int, required=True)
+    parser.add_argument("--latency-ms", type=float, default=0.0, help="one way delay of forwarded data")
+    parser.add_argument("--bandwidth", type=int, default=0, help="bytes per second in each direction, 0 unlimited")
+    parser.add_argument("--reset-rate", type=float, default=0.0, help="probability of resetting a connection")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="probability of answering with 503")
+    parser.add_argument("--seed", type=int, default=0)
+    args = parser.parse_args()
+    args.latency = args.latency_ms / 1000.0
+
+    rng = random.Random(args.seed)
+    buckets = (TokenBucket(args.bandwidth), TokenBucket(args.bandwidth))
+
+    async def serve():
+        server = await asyncio.start_server(
+            lambda reader, writer: handle_connection(args, rng, buckets, reader, writer),
+            args.listen_host, args.listen_port)
+        async with server:
+            await server.serve_forever()
+
+    asyncio.run(serve())
+
+
+if __name__ == "__main__":
+    main()